@@ -9,11 +9,56 @@
 #define SCTLR_EE_LITTLE_ENDIAN          (0 << 25)
 #define SCTLR_EOE_LITTLE_ENDIAN         (0 << 24)
 #define SCTLR_I_CACHE_DISABLED          (0 << 12)
+#define SCTLR_I_CACHE_ENABLED           (1 << 12)
 #define SCTLR_D_CACHE_DISABLED          (0 << 2)
+#define SCTLR_D_CACHE_ENABLED           (1 << 2)
 #define SCTLR_MMU_DISABLED              (0 << 0)
 #define SCTLR_MMU_ENABLED               (1 << 0)
 
 #define SCTLR_VALUE_MMU_DISABLED	    (SCTLR_RESERVED | SCTLR_EE_LITTLE_ENDIAN | SCTLR_I_CACHE_DISABLED | SCTLR_D_CACHE_DISABLED | SCTLR_MMU_DISABLED)
+#define SCTLR_VALUE_MMU_ENABLED         (SCTLR_RESERVED | SCTLR_EE_LITTLE_ENDIAN | SCTLR_I_CACHE_ENABLED | SCTLR_D_CACHE_ENABLED | SCTLR_MMU_ENABLED)
+
+// ***************************************
+// MAIR_EL1, Memory Attribute Indirection Register (EL1), Page 2609 of AArch64-Reference-Manual.
+// ***************************************
+
+// Attribute indexes used by the AttrIndx field of a block descriptor
+#define MT_DEVICE_nGnRnE                0
+#define MT_DEVICE_nGnRE                 1
+#define MT_NORMAL                       2
+#define MT_NORMAL_NC                    3
+
+#define MT_DEVICE_nGnRnE_FLAGS          0x00
+#define MT_DEVICE_nGnRE_FLAGS           0x04
+#define MT_NORMAL_FLAGS                 0xFF    // Inner/Outer Write-Back, Read/Write-Allocate
+#define MT_NORMAL_NC_FLAGS              0x44    // Inner/Outer Non-Cacheable
+
+#define MAIR_VALUE                      ((MT_DEVICE_nGnRnE_FLAGS << (8 * MT_DEVICE_nGnRnE)) | \
+                                         (MT_DEVICE_nGnRE_FLAGS << (8 * MT_DEVICE_nGnRE)) | \
+                                         (MT_NORMAL_FLAGS << (8 * MT_NORMAL)) | \
+                                         (MT_NORMAL_NC_FLAGS << (8 * MT_NORMAL_NC)))
+
+// ***************************************
+// TCR_EL1, Translation Control Register (EL1), Page 2685 of AArch64-Reference-Manual.
+// ***************************************
+
+#define TCR_T0SZ                        (64 - 39)   // 39-bit VA, translation starts at level 1
+#define TCR_IRGN0_WBWA                  (1 << 8)
+#define TCR_ORGN0_WBWA                  (1 << 10)
+#define TCR_SH0_INNER                   (3 << 12)
+#define TCR_TG0_4K                      (0 << 14)
+#define TCR_EPD1_DISABLE                (1 << 23)   // No TTBR1 walks, the kernel is identity mapped
+#define TCR_IPS_40BIT                   0x200000000 // (2 << 32)
+
+#define TCR_VALUE                       (TCR_T0SZ | TCR_IRGN0_WBWA | TCR_ORGN0_WBWA | TCR_SH0_INNER | \
+                                         TCR_TG0_4K | TCR_EPD1_DISABLE | TCR_IPS_40BIT)
+
+// ***************************************
+// TTBR0_EL1, Translation Table Base Register 0 (EL1), Page 2709 of AArch64-Reference-Manual.
+// ***************************************
+
+#define TTBR_BADDR_MASK                 0x0000FFFFFFFFF000  // Table must be 4KB aligned
+#define TTBR_CNP                        (1 << 0)
 
 // ***************************************
 // HCR_EL2, Hypervisor Configuration Register (EL2), Page 2487 of AArch64-Reference-Manual.
@@ -22,6 +67,25 @@
 #define HCR_RW	    			        (1 << 31)
 #define HCR_VALUE			            HCR_RW
 
+// ***************************************
+// CPTR_EL2, Architectural Feature Trap Register (EL2), Page 2445 of AArch64-Reference-Manual.
+// ***************************************
+
+#define CPTR_EL2_RES1                   0x33FF      // TFP (bit 10) clear: no FP/SIMD traps to EL2
+#define CPTR_EL2_VALUE                  CPTR_EL2_RES1
+
+// ***************************************
+// CPACR_EL1, Architectural Feature Access Control Register, Page 2411 of AArch64-Reference-Manual.
+// ***************************************
+
+#define CPACR_FPEN_TRAP                 (0 << 20)   // Trap FP/SIMD at EL0 and EL1
+#define CPACR_FPEN                      (3 << 20)   // No FP/SIMD traps
+#define CPACR_VALUE                     CPACR_FPEN
+
+// ESR_EL1 exception class for a trapped FP/SIMD access
+#define ESR_EC_SHIFT                    26
+#define ESR_EC_FP_ASIMD                 0x07
+
 // ***************************************
 // SCR_EL3, Secure Configuration Register (EL3), Page 2648 of AArch64-Reference-Manual.
 // ***************************************
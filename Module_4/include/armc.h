@@ -0,0 +1,53 @@
+#ifndef ARMC_H
+#define ARMC_H
+
+#include <common.h>
+
+#define ARMC_BASE           (PERIPHERAL_BASE + 0xB000)
+
+// IRQ0 Registers (Legacy)
+typedef struct {
+    volatile uint32_t IRQ0_PENDING0;
+    volatile uint32_t IRQ0_PENDING1;
+    volatile uint32_t IRQ0_PENDING2;
+    volatile uint32_t res0;
+    volatile uint32_t IRQ0_ENABLE_0;
+    volatile uint32_t IRQ0_ENABLE_1;
+    volatile uint32_t IRQ0_ENABLE_2;
+    volatile uint32_t res1;
+    volatile uint32_t IRQ0_DISABLE_0;
+    volatile uint32_t IRQ0_DISABLE_1;
+    volatile uint32_t IRQ0_DISABLE_2;
+} armc_irq0_regs;
+
+#define IRQ0_REGS ((armc_irq0_regs *) (ARMC_BASE + 0x200))
+
+#define IRQ_STATUS0         (ARMC_BASE + 0x230)
+#define IRQ_STATUS1         (ARMC_BASE + 0x234)
+#define IRQ_STATUS2         (ARMC_BASE + 0x238)
+
+// The ARMC reports VideoCore interrupts 0-63 in PENDING0/1 and ARM-side ones in PENDING2[15:0].
+// Each maps to its GIC interrupt ID, so handlers register under the same number with either controller.
+#define ARMC_NUM_BANKS      3
+#define ARMC_ARM_IRQ_BASE   0x40        // PENDING2 bit n = GIC ID 64 + n
+#define ARMC_VC_IRQ_BASE    0x60        // PENDING0 bit n = GIC ID 96 + n, PENDING1 bit n = GIC ID 128 + n
+#define ARMC_ARM_IRQ_MASK   0xFFFF
+#define ARMC_PENDING0_ANY   (1 << 24)   // PENDING2 summary bits: PENDING0/PENDING1 have bits set
+#define ARMC_PENDING1_ANY   (1 << 25)
+
+/**
+ * Index of the lowest set bit (bits must be non-zero): rbit turns it into the highest, clz counts to it.
+ */
+static inline uint32_t armc_lowest_bit(uint32_t bits) {
+    uint32_t bit;
+    asm("rbit %w0, %w1\n\tclz %w0, %w0" : "=r"(bit) : "r"(bits));
+    return bit;
+}
+
+void armc_init();
+uint32_t armc_enable_interrupt(uint32_t irq);
+void armc_disable_interrupt(uint32_t irq);
+uint32_t armc_read_pending(uint32_t pending[ARMC_NUM_BANKS]);
+uint32_t armc_bank_irq(uint32_t bank);
+
+#endif /* ARMC_H */
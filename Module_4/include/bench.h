@@ -0,0 +1,19 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <common.h>
+
+// Benchmarks are only built in with `make BENCH=1`
+
+// Reserved for the interrupt benchmarks: SPIs with no device behind them, only ever pended by software
+#define BENCH_IRQ_NEST_FLOOD    0xF0
+#define BENCH_IRQ_ENTRY         0xF1
+#define BENCH_IRQ_FIQ           0xF2
+#define BENCH_IRQ_DEFER         0xF3
+#define BENCH_IRQ_AFFINITY      0xF4
+#define BENCH_IRQ_LAT_FLOOD     0xF5
+
+void bench_report(char *name, uint64_t cycles, uint64_t bytes);
+void bench_run();
+
+#endif /* BENCH_H */
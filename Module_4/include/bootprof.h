@@ -0,0 +1,13 @@
+#ifndef BOOTPROF_H
+#define BOOTPROF_H
+
+#include <common.h>
+
+#define BOOTPROF_MAX_PHASES     16
+
+// Boot phase timestamps taken from CNTPCT_EL0, starting at entry to _start
+void bootprof_init(uint64_t start_ticks);
+void bootprof_mark(char *phase);
+void bootprof_dump();
+
+#endif /* BOOTPROF_H */
@@ -0,0 +1,40 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <common.h>
+
+// GPIO logic capture: a dedicated core polls GPLEV0/1 into a single-producer, single-consumer ring
+#define CAPTURE_RING_SIZE       4096        // Records (power of two)
+#define CAPTURE_PINS_MASK       ((1ULL << 54) - 1)
+
+// Binary stream (little-endian): one header, then one frame per record, then an end frame
+#define CAPTURE_MAGIC           0x54504143  // "CAPT"
+#define CAPTURE_VERSION         1
+#define CAPTURE_FRAME_RECORD    0xA5        // u32 ticks since the previous record, packed levels
+#define CAPTURE_FRAME_TIME      0xA6        // u64 absolute ticks, before a record more than a u32 away
+#define CAPTURE_FRAME_END       0x5A        // u64 polls, u64 records, u64 dropped
+
+// The captured pins' levels (bit n = GPIO n) from the poll that saw them change
+typedef struct {
+    uint64_t ticks;             // CNTPCT
+    uint64_t levels;
+} capture_record_t;
+
+typedef struct {
+    uint64_t polls;             // GPLEV samples taken
+    uint64_t records;           // Level changes stored
+    uint64_t dropped;           // Polls that saw a change with the ring full
+    uint64_t start;             // CNTPCT of the first and last poll
+    uint64_t end;
+    uint32_t max_fill;          // Most records waiting in the ring at once
+} capture_stats_t;
+
+uint32_t capture_start(uint32_t cpu, uint64_t pin_mask, uint32_t duration_us);
+void capture_stop();
+uint32_t capture_active();
+uint32_t capture_read(capture_record_t *records, uint32_t max);
+void capture_stream();
+void capture_get_stats(capture_stats_t *stats);
+void capture_dump();
+
+#endif /* CAPTURE_H */
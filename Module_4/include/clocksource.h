@@ -0,0 +1,66 @@
+#ifndef CLOCKSOURCE_H
+#define CLOCKSOURCE_H
+
+#include <common.h>
+#include <timer.h>
+
+// Counter ticks to nanoseconds: ns = (ticks * mult) >> CLOCK_SHIFT, with a 128-bit product so
+// the whole 64-bit count converts without overflow
+#define CLOCK_SHIFT             32
+#define CLOCK_NS_PER_SEC        1000000000ULL
+#define CLOCK_CALIBRATE_MS      10      // PMU cycles are measured against the counter for this long
+
+typedef enum {
+    clock_src_cntpct = 0,   // ARM Generic Timer: a system register read, no MMIO
+    clock_src_bcm           // BCM System Timer CHI/CLO (1 MHz), if CNTFRQ_EL0 was never set
+} clock_src_t;
+
+/**
+ * Written once by clocksource_init() on the main core before the secondaries start, and
+ * read-only afterwards, so readers need no lock.
+ */
+typedef struct {
+    clock_src_t source;
+    uint64_t freq;              // Counter Hz
+    uint64_t mult;              // Nanoseconds per tick << CLOCK_SHIFT
+    uint64_t ns_mult;           // Ticks per nanosecond << CLOCK_SHIFT
+    uint64_t cpu_hz;            // PMU cycle counter rate, calibrated against the counter
+    uint64_t cycle_mult;        // Nanoseconds per PMU cycle << CLOCK_SHIFT
+} clocksource_t;
+
+extern clocksource_t clocksource;
+
+static inline uint64_t clock_scale(uint64_t value, uint64_t mult) {
+    return (uint64_t)(((unsigned __int128)value * mult) >> CLOCK_SHIFT);
+}
+
+/**
+ * Raw counter value of the active source.
+ */
+static inline uint64_t clock_read() {
+    return clocksource.source == clock_src_cntpct ? get_cntpct() : get_timer64();
+}
+
+static inline uint64_t clock_ticks_to_ns(uint64_t ticks) {
+    return clock_scale(ticks, clocksource.mult);
+}
+
+static inline uint64_t clock_ns_to_ticks(uint64_t ns) {
+    return clock_scale(ns, clocksource.ns_mult);
+}
+
+static inline uint64_t cycles_to_ns(uint64_t cycles) {
+    return clock_scale(cycles, clocksource.cycle_mult);
+}
+
+/**
+ * Monotonic nanoseconds since the counter started.
+ */
+static inline uint64_t now_ns() {
+    return clock_ticks_to_ns(clock_read());
+}
+
+void clocksource_init();
+void clocksource_dump();
+
+#endif /* CLOCKSOURCE_H */
@@ -17,5 +17,6 @@ typedef unsigned long      uintptr_t;  // Pointer-sized integer
 
 #define NULL ((void*)0)
 #define PERIPHERAL_BASE         0xFE000000
+#define CACHE_LINE_SIZE         64  // Cortex-A72 L1/L2 line size
 
 #endif /* COMMON_H */
\ No newline at end of file
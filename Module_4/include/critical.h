@@ -0,0 +1,42 @@
+#ifndef CRITICAL_H
+#define CRITICAL_H
+
+#include <common.h>
+#include <smp.h>
+
+// GICC_PMR value with no interrupts masked
+#define PMR_UNMASKED            0xFF
+
+// Hold-time counters for one critical section on one core
+typedef struct {
+    uint64_t count;
+    uint64_t cycles_total;
+    uint64_t cycles_max;
+} crit_stats_t;
+
+/**
+ * A critical section masks, through GICC_PMR, only the interrupts at or below `priority`:
+ * the ones whose handlers share data with it. Higher priority interrupts still preempt, so
+ * their handlers must not touch that data (or take a lock held inside the section).
+ */
+typedef struct {
+    char *name;
+    uint32_t priority;
+    crit_stats_t stats[NUM_CORES];
+} crit_section_t;
+
+#define CRIT_SECTION_INIT(n, prio)  { .name = (n), .priority = (prio) }
+
+// Returned by crit_enter(), handed back to crit_exit()
+typedef struct {
+    uint32_t prev_pmr;
+    uint64_t start;
+} crit_state_t;
+
+crit_state_t crit_enter(crit_section_t *cs);
+void crit_exit(crit_section_t *cs, crit_state_t state);
+uint32_t crit_active();
+void crit_get_stats(crit_section_t *cs, crit_stats_t *stats);
+void crit_dump(crit_section_t *cs);
+
+#endif /* CRITICAL_H */
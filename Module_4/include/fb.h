@@ -1,7 +1,7 @@
 #ifndef FB_H
 #define FB_H
 
-void fb_init();
+unsigned int fb_init();
 void drawPixel(int x, int y, unsigned char attr);
 void drawChar(unsigned char ch, int x, int y, unsigned char attr);
 void drawString(const char* str, int x, int y, unsigned char attr);
@@ -8,9 +8,18 @@
 #define GICD_BASE           (GIC_BASE + 0x1000)
 #define GICC_BASE           (GIC_BASE + 0x2000) 
 
+// Interrupt IDs implemented by the BCM2711 GIC-400 (SGIs 0-15, PPIs 16-31, SPIs 32-255)
+#define GIC_NUM_IRQS        256
+#define GIC_NUM_SGIS        16
+#define GIC_FIRST_SPI       32          // SGIs and PPIs (0-31) are banked per core and can't be routed
+#define GIC_SGI_PRIORITY    0x80        // IPIs preempt device interrupts so a sleeping core wakes promptly
+#define GIC_SPURIOUS_IRQ    1023
+#define GICC_IAR_ID_MASK    0x3FF
+
 // ----------------------- GIC Distributor -----------------------
 #define GICD_CTLR           (GICD_BASE + 0x000)
 #define GICD_IIDR           (GICD_BASE + 0x008)
+#define GICD_IGROUPR        (GICD_BASE + 0x080)     // 0 = Group 0 (FIQ), 1 = Group 1 (IRQ). Secure access only
 #define GICD_SET_ENABLER    (GICD_BASE + 0x100)
 #define GICD_CLR_ENABLER    (GICD_BASE + 0x180)
 #define GICD_SET_PENDING    (GICD_BASE + 0x200)
@@ -19,7 +28,8 @@
 #define GICD_CLR_ACTIVE     (GICD_BASE + 0x380)
 #define GICD_PRIORITY       (GICD_BASE + 0x400)
 #define GICD_TARGET         (GICD_BASE + 0x800)
-#define GICD_ICFGR          (GICD_BASE + 0xC08)
+#define GICD_ICFGR          (GICD_BASE + 0xC00)
+#define GICD_SGIR           (GICD_BASE + 0xF00)
 
 typedef enum {
     gicdctlr_EnableGrp0 = (1 << 0),
@@ -45,6 +55,10 @@ typedef enum {
 #define GICC_IAR            (GICC_BASE + 0x000C)
 #define GICC_EOIR           (GICC_BASE + 0x0010)
 
+// Secure GICC_CTLR bits
+#define GICC_CTLR_ACKCTL    (1 << 2)    // GICC_IAR also acknowledges Group 1 interrupts
+#define GICC_CTLR_FIQEN     (1 << 3)    // Signal Group 0 interrupts as FIQ
+
 #define GICC_IIDR           (GICC_BASE + 0x00FC)
 #define GICC_DIR            (GICC_BASE + 0x1000)
 
@@ -53,10 +67,17 @@ void gic_dist_init();
 void gic_dist_clr();
 void gic_cpu_init();
 void enable_interrupt(uint32_t irq);
+void disable_interrupt(uint32_t irq);
+void set_pending(uint32_t irq);
 void set_irq_priority(uint32_t irq, uint32_t priority);
 void assign_target(uint32_t irq);
+void gic_set_target(uint32_t irq, uint32_t cpu_mask);
+uint32_t gic_get_target(uint32_t irq);
 void clear_interrupt(uint32_t irq);
 void setup_interrupt(uint32_t irq, uint32_t priority, gicd_cfg_flags_t flag);
+uint32_t gic_set_fiq(uint32_t irq, uint32_t priority, gicd_cfg_flags_t flag);
+void gic_clear_fiq();
+void gic_send_sgi(uint32_t cpu_mask, uint32_t sgi);
 
 void gic_init();
 
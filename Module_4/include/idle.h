@@ -0,0 +1,13 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <common.h>
+
+void cpu_idle();
+void sleep_until(uint64_t deadline_ns);
+void sleep_us(uint64_t us);
+uint32_t idle_residency(uint32_t cpu);
+void idle_reset();
+void idle_dump();
+
+#endif /* IDLE_H */
@@ -0,0 +1,23 @@
+#ifndef IPI_H
+#define IPI_H
+
+#include <common.h>
+#include <irq.h>
+#include <smp.h>
+
+// IPI types, one per SGI ID (0-15)
+#define IPI_WAKEUP              0   // Only wakes the target from wfi/wfe
+#define IPI_TLB_FLUSH           1   // Target invalidates its local TLB
+#define IPI_PING                2   // Cross-core round trip benchmark
+#define IPI_CAPTURE             3   // Target starts the GPIO capture loop
+#define IPI_NUM_TYPES           GIC_NUM_SGIS
+
+#define IPI_ALL_CPUS            ((1 << NUM_CORES) - 1)
+
+void ipi_init();
+uint32_t ipi_register(uint32_t type, irq_handler_t handler, void *ctx);
+void ipi_unregister(uint32_t type);
+void ipi_send(uint32_t cpu_mask, uint32_t type);
+void ipi_send_others(uint32_t type);
+
+#endif /* IPI_H */
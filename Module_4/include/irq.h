@@ -2,29 +2,10 @@
 #define IRQ_H
 
 #include <common.h>
-#define PACTL_CS            0xFE204E00
-#define ARMC_BASE           (PERIPHERAL_BASE + 0xB000)
+#include <gic.h>
+#include <armc.h>
 
-// IRQ0 Registers (Legacy)
-typedef struct {
-    volatile uint32_t IRQ0_PENDING0;
-    volatile uint32_t IRQ0_PENDING1;
-    volatile uint32_t IRQ0_PENDING2;
-    volatile uint32_t res0;
-    volatile uint32_t IRQ0_ENABLE_0;
-    volatile uint32_t IRQ0_ENABLE_1;
-    volatile uint32_t IRQ0_ENABLE_2;
-    volatile uint32_t res1;
-    volatile uint32_t IRQ0_DISABLE_0;
-    volatile uint32_t IRQ0_DISABLE_1;
-    volatile uint32_t IRQ0_DISABLE_2;
-} armc_irq0_regs;
-
-#define IRQ0_REGS ((armc_irq0_regs *) (ARMC_BASE + 0x200))
-
-#define IRQ_STATUS0         (ARMC_BASE + 0x230)
-#define IRQ_STATUS1         (ARMC_BASE + 0x234)
-#define IRQ_STATUS2         (ARMC_BASE + 0x238)
+#define PACTL_CS            0xFE204E00
 
 // Interrupt IRQ IDs
 #define VC_IRQ_BASE_ID         0x60
@@ -35,8 +16,81 @@ typedef struct {
 
 #define PL011_UART_IRQ      (VC_IRQ_BASE_ID + 0x39)
 
+// ----------------------- IRQ Registry -----------------------
+typedef void (*irq_handler_t)(void *ctx);
+
+// Default limit on nested IRQ handlers per core (each level costs an IRQ + lazy FP/SIMD frame on the stack)
+#ifndef IRQ_MAX_NESTING
+#define IRQ_MAX_NESTING     4
+#endif
+
+// Histogram of interrupts handled per exception entry (last bucket is "this many or more")
+#define IRQ_DRAIN_BUCKETS   8
+
+// How often the balancer runs while irq_set_balancing() is on
+#define IRQ_BALANCE_PERIOD_US   1000000
+
+// Longest IRQ-off spans kept per core (BENCH builds)
+#define IRQ_OFF_TOP         8
+#define DAIF_IRQ            (1 << 7)
+
+typedef struct {
+    uint64_t cycles;
+    uintptr_t site;             // Code that masked IRQs (irq_el1h_handler for exception entry)
+} irq_off_span_t;
+
+// Handler and context for one GIC interrupt ID
+typedef struct {
+    irq_handler_t handler;
+    void *ctx;
+} irq_desc_t;
+
+// Per-IRQ counters, summed over every core that took the interrupt
+typedef struct {
+    uint64_t count;
+    uint64_t cycles_total;      // Cycles spent in the handler
+    uint64_t cycles_max;        // Longest single handler run
+} irq_stats_t;
+
+/**
+ * Masks IRQs on this core. Returns the previous DAIF for irq_restore().
+ */
+static inline uint64_t irq_save() {
+    uint64_t flags;
+    asm volatile("mrs %0, DAIF\n\tmsr DAIFSet, #2" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint64_t flags) {
+    asm volatile("msr DAIF, %0" :: "r"(flags) : "memory");
+}
+
 // Functions
 void exception_report(uint64_t type, uint64_t esr_reg, uint64_t elr, uint64_t spsr);
 void irq_el1h_handler();
+void fiq_el1h_handler();
+void irq_enable();
+void irq_disable();
+void fiq_enable();
+
+uint32_t irq_register(uint32_t irq, irq_handler_t handler, void *ctx, uint32_t priority, gicd_cfg_flags_t trigger);
+void irq_unregister(uint32_t irq);
+void irq_set_max_nesting(uint32_t depth);
+uint32_t irq_set_affinity(uint32_t irq, uint32_t cpu_mask);
+uint32_t irq_get_affinity(uint32_t irq);
+void irq_isolate(uint32_t cpu_mask);
+void irq_unpin(uint32_t irq);
+uint32_t irq_balance();
+void irq_set_balancing(uint32_t enabled);
+uint32_t fiq_register(uint32_t irq, irq_handler_t handler, void *ctx, uint32_t priority, gicd_cfg_flags_t trigger);
+void fiq_unregister();
+void irq_get_stats(uint32_t irq, irq_stats_t *stats);
+uint64_t irq_unhandled_count();
+uint64_t irq_max_off_cycles();
+void irq_reset_max_off();
+void irq_off_report();
+void irq_off_reset();
+void irq_get_drain_hist(uint64_t hist[IRQ_DRAIN_BUCKETS]);
+void irq_stats_dump();
 
 #endif /* IRQ_H */
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef KMEM_H
+#define KMEM_H
+
+#include <common.h>
+#include <spinlock.h>
+
+// Size classes 16 B - 2 KB, objects are aligned to their size (64 B and up are cache-line aligned)
+#define KMEM_MIN_SHIFT          4
+#define KMEM_MAX_SHIFT          11
+#define KMEM_NUM_CLASSES        (KMEM_MAX_SHIFT - KMEM_MIN_SHIFT + 1)
+
+// Slabs are carved from the static arena in link.ld
+#define KMEM_SLAB_SHIFT         16          // 64 KB slabs
+#define KMEM_SLAB_SIZE          (1 << KMEM_SLAB_SHIFT)
+#define KMEM_MAX_SLABS          256         // Arena up to 16 MB
+
+// Per-CPU magazines: one per core, per IRQ nesting level (thread = 0) and per size class
+#define KMEM_MAG_SIZE           28
+#define KMEM_BATCH              (KMEM_MAG_SIZE / 2)
+#define KMEM_CONTEXTS           4
+
+typedef struct {
+    uint32_t obj_size;
+    spinlock_t lock;
+    void *free_list;        // Objects not held by any magazine, linked through their first word
+    uint64_t slabs;
+    uint64_t refills;
+    uint64_t flushes;
+} kmem_cache_t;
+
+void kmem_init();
+
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+kmem_cache_t *kmem_size_cache(size_t size);
+
+void *kmalloc(size_t size);
+void kfree(void *obj);
+
+void kmem_dump();
+
+#endif /* KMEM_H */
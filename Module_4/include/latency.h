@@ -0,0 +1,31 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <common.h>
+
+// Interrupt latency suite: System Timer C3 deadlines, timestamped with CNTPCT on handler entry
+#define LAT_SAMPLES             2000
+#define LAT_PERIOD_US           250
+#define LAT_BUCKET_NS           100
+#define LAT_BUCKETS             64      // 0 - 6.4 us, plus one overflow bucket
+
+typedef enum {
+    lat_load_idle = 0,      // Core 0 waits in wfi
+    lat_load_uart_flood,    // Back-to-back interrupts at the UART's priority
+    lat_load_busy,          // Core 0 streams memcpy over a buffer larger than L1
+    lat_num_loads
+} lat_load_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t total_ns;
+    uint32_t hist[LAT_BUCKETS + 1];
+} lat_hist_t;
+
+void latency_measure(lat_load_t load, lat_hist_t *hist);
+void latency_report(char *name, lat_hist_t *hist);
+void latency_run();
+
+#endif /* LATENCY_H */
@@ -0,0 +1,49 @@
+#ifndef LOCAL_TIMER_H
+#define LOCAL_TIMER_H
+
+#include <common.h>
+#include <irq.h>
+
+// EL1 physical timer (CNTP): one per core, raised as a banked PPI, programmed with system registers
+#define LOCAL_TIMER_IRQ         30          // CNTPNSIRQ
+#define LOCAL_TIMER_PRIORITY    0x90        // The System Timer's level
+#define LOCAL_TIMER_NONE        (~0ULL)
+
+// CNTP_CTL_EL0 bits
+#define CNTP_CTL_ENABLE         (1 << 0)
+#define CNTP_CTL_IMASK          (1 << 1)
+#define CNTP_CTL_ISTATUS        (1 << 2)
+
+// This core's timer: what to call when it fires, and the period when it ticks. CNTP also carries
+// the sleep wakeup, so it's set for whichever of the two comes first.
+typedef struct {
+    irq_handler_t handler;
+    void *ctx;
+    uint64_t period;                // CNTPCT ticks between ticks, 0 = one-shot
+    uint64_t deadline;              // CNTPCT value the user timer is set for
+    uint32_t armed;
+    uint64_t wake;                  // Sleep wakeup (CNTPCT), LOCAL_TIMER_NONE when nobody sleeps
+    uint32_t ready;                 // local_timer_init() has run on this core
+    uint64_t fired;
+} __attribute__((aligned(CACHE_LINE_SIZE))) local_timer_t;
+
+static inline void cntp_write_ctl(uint64_t ctl) {
+    asm volatile("msr CNTP_CTL_EL0, %0\n\tisb" :: "r"(ctl) : "memory");
+}
+
+static inline void cntp_write_cval(uint64_t cval) {
+    asm volatile("msr CNTP_CVAL_EL0, %0" :: "r"(cval) : "memory");
+}
+
+uint32_t local_timer_init();
+void local_timer_set_handler(irq_handler_t handler, void *ctx);
+void local_timer_at(uint64_t deadline);
+void local_timer_after(uint32_t us);
+void local_timer_start_tick(uint32_t period_us);
+void local_timer_stop();
+uint32_t local_timer_wake_at(uint64_t deadline);
+uint64_t local_timer_fired();
+uint64_t local_timer_us_to_ticks(uint64_t us);
+uint64_t local_timer_now_us();
+
+#endif /* LOCAL_TIMER_H */
@@ -26,6 +26,7 @@ extern volatile unsigned int __attribute__((aligned(16))) mbox[36];
 #define MBOX_TAG_SETPWR         0x00028001
 #define MBOX_TAG_SETCLK         0x00038002
 #define MBOX_TAG_GETCLK         0x00030002
+#define MBOX_TAG_GET_ARM_MEM    0x00010005
 
 // Set framebuffer tags
 #define MBOX_TAG_PHYS_DIM       0x00048003
@@ -0,0 +1,35 @@
+#ifndef MMU_H
+#define MMU_H
+
+#include <common.h>
+
+// ----------------------- Translation Layout -----------------------
+// 4KB granule, 39-bit VA: each L1 entry covers 1GB and each L2 entry is a 2MB block
+#define PAGE_SHIFT              12
+#define PAGE_SIZE               (1 << PAGE_SHIFT)
+#define SECTION_SHIFT           21
+#define SECTION_SIZE            (1 << SECTION_SHIFT)
+#define L1_SHIFT                30
+#define TABLE_ENTRIES           512
+#define MMU_NUM_L2              4           // Identity map the low 4GB
+
+// Start of the low-peripheral window (main peripherals at 0xFE000000, GIC at 0xFF840000)
+#define DEVICE_BASE             0xFC000000
+
+// ----------------------- Descriptor Bits -----------------------
+#define PD_TABLE                0x3
+#define PD_BLOCK                0x1
+#define PD_ATTR(idx)            ((uint64_t)(idx) << 2)
+#define PD_SH_INNER             (3 << 8)
+#define PD_AF                   (1 << 10)
+#define PD_PXN                  ((uint64_t)1 << 53)
+#define PD_UXN                  ((uint64_t)1 << 54)
+
+// ----------------------- MMU Functions -----------------------
+void mmu_init();
+void mmu_enable();
+void mmu_set_region(uintptr_t base, size_t size, uint32_t attr);
+
+void dcache_clean_inval(uintptr_t start, size_t size);
+
+#endif /* MMU_H */
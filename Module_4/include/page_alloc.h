@@ -0,0 +1,28 @@
+#ifndef PAGE_ALLOC_H
+#define PAGE_ALLOC_H
+
+#include <common.h>
+#include <mmu.h>
+
+// Buddy allocator over 4KB pages: order n hands out 2^n contiguous, 2^n-page aligned pages
+#define PAGE_MAX_ORDER          12          // Orders 0 - 11 (4KB - 8MB)
+
+#define PAGE_ORDER_SIZE(order)  ((size_t)PAGE_SIZE << (order))
+
+typedef struct {
+    uint64_t total_pages;
+    uint64_t free_pages;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t failed;
+    uint32_t free_blocks[PAGE_MAX_ORDER];   // Free list length per order
+} page_alloc_stats_t;
+
+void page_alloc_init();
+void *page_alloc(uint32_t order);
+void page_free(void *addr, uint32_t order);
+
+void page_alloc_get_stats(page_alloc_stats_t *stats);
+void page_alloc_dump();
+
+#endif /* PAGE_ALLOC_H */
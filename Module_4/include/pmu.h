@@ -0,0 +1,31 @@
+#ifndef PMU_H
+#define PMU_H
+
+#include <common.h>
+
+// PMCR_EL0 bits
+#define PMCR_E              (1 << 0)    // Enable all counters
+#define PMCR_C              (1 << 2)    // Reset the cycle counter
+#define PMCR_LC             (1 << 6)    // 64-bit cycle counter overflow
+
+#define PMCNTEN_CYCLES      (1 << 31)
+
+/**
+ * Starts the per-core cycle counter (PMCCNTR_EL0). Every core has its own PMU.
+ */
+static inline void pmu_init() {
+    asm volatile("msr PMCR_EL0, %0" :: "r"((uint64_t)(PMCR_E | PMCR_C | PMCR_LC)));
+    asm volatile("msr PMCNTENSET_EL0, %0" :: "r"((uint64_t)PMCNTEN_CYCLES));
+    asm volatile("isb");
+}
+
+/**
+ * Reads the CPU cycle counter.
+ */
+static inline uint64_t pmu_cycles() {
+    uint64_t cycles;
+    asm volatile("isb; mrs %0, PMCCNTR_EL0" : "=r"(cycles) :: "memory");
+    return cycles;
+}
+
+#endif /* PMU_H */
@@ -0,0 +1,51 @@
+#ifndef SMP_H
+#define SMP_H
+
+#define NUM_CORES               4
+#define CORE_STACK_SIZE         0x10000     // Core n's stack starts at _start - (n * CORE_STACK_SIZE)
+#define FIQ_STACK_SIZE          0x1000      // Per-core FIQ stack, kept in SP_EL0
+
+// percpu_t offsets used by assembly
+#define PERCPU_FPSIMD_FRAME     8
+#define PERCPU_IRQ_DEPTH        16
+
+#ifndef __ASSEMBLER__
+
+#include <common.h>
+
+// Per-core data, one cache line (or more) per core so cores never share a line
+typedef struct {
+    uint32_t cpu_id;
+    volatile uint32_t online;
+    uint64_t fpsimd_frame;      // Innermost IRQ frame, where a lazy FP/SIMD trap saves q0-q31
+    uint32_t irq_depth;         // IRQ handlers active on this core (0 = thread context)
+    uint32_t crit_depth;        // GICC_PMR critical sections active on this core
+    uint64_t idle_ticks;        // CNTPCT ticks spent in wfi since idle_reset()
+} __attribute__((aligned(CACHE_LINE_SIZE))) percpu_t;
+
+_Static_assert(__builtin_offsetof(percpu_t, fpsimd_frame) == PERCPU_FPSIMD_FRAME, "percpu_t layout");
+_Static_assert(__builtin_offsetof(percpu_t, irq_depth) == PERCPU_IRQ_DEPTH, "percpu_t layout");
+
+extern percpu_t percpu_data[NUM_CORES];
+
+/**
+ * Returns the calling core's per-CPU data (TPIDR_EL1 holds its address).
+ */
+static inline percpu_t *this_cpu() {
+    percpu_t *cpu;
+    asm volatile("mrs %0, TPIDR_EL1" : "=r"(cpu));
+    return cpu;
+}
+
+static inline uint32_t smp_cpu_id() {
+    return this_cpu()->cpu_id;
+}
+
+void smp_percpu_init(uint32_t cpu);
+void smp_init();
+uint32_t smp_num_online();
+uint32_t smp_online_mask();
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* SMP_H */
@@ -0,0 +1,32 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <common.h>
+
+// Deferred work queued by interrupt handlers, one queue per core (power of two)
+#define SOFTIRQ_QUEUE_SIZE      64
+
+typedef void (*softirq_fn_t)(void *arg);
+
+typedef struct {
+    softirq_fn_t fn;
+    void *arg;
+    volatile uint32_t ready;    // Set (release) once fn/arg are written
+} softirq_item_t;
+
+typedef struct {
+    volatile uint32_t head;     // Next slot to reserve (producers, ldaxr/stxr)
+    volatile uint32_t tail;     // Next slot to run (consumer)
+    volatile uint32_t running;  // softirq_run() is active on this core
+    uint64_t raised;
+    uint64_t dropped;           // Queue was full
+    uint64_t ran;
+    softirq_item_t items[SOFTIRQ_QUEUE_SIZE];
+} __attribute__((aligned(CACHE_LINE_SIZE))) softirq_queue_t;
+
+uint32_t softirq_raise(softirq_fn_t fn, void *arg);
+uint32_t softirq_pending();
+void softirq_run();
+void softirq_dump();
+
+#endif /* SOFTIRQ_H */
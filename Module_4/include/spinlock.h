@@ -0,0 +1,57 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <common.h>
+
+// Exclusive-access spinlock. Needs the MMU and caches on (exclusives on Device memory never succeed).
+typedef struct {
+    volatile uint32_t lock;
+} spinlock_t;
+
+#define SPINLOCK_INIT   { 0 }
+
+#ifdef NO_MMU
+// Without the MMU smp_init() leaves cores 1-3 parked, so the lock is only ever taken on core 0
+// and the IRQ masking in the irqsave variants is all the exclusion needed
+static inline void spin_lock(spinlock_t *l) {
+    asm volatile("" ::: "memory");
+}
+
+static inline void spin_unlock(spinlock_t *l) {
+    asm volatile("" ::: "memory");
+}
+#else
+static inline void spin_lock(spinlock_t *l) {
+    uint32_t tmp;
+    asm volatile(
+        "   sevl\n"
+        "1: wfe\n"
+        "2: ldaxr   %w0, [%1]\n"
+        "   cbnz    %w0, 1b\n"
+        "   stxr    %w0, %w2, [%1]\n"
+        "   cbnz    %w0, 2b\n"
+        : "=&r"(tmp) : "r"(&l->lock), "r"(1) : "memory");
+}
+
+static inline void spin_unlock(spinlock_t *l) {
+    // The release store clears the exclusive monitor of any waiter, waking its wfe
+    asm volatile("stlr wzr, [%0]" :: "r"(&l->lock) : "memory");
+}
+#endif /* NO_MMU */
+
+/**
+ * Masks IRQs on this core and takes the lock. Returns the previous DAIF for spin_unlock_irqrestore().
+ */
+static inline uint64_t spin_lock_irqsave(spinlock_t *l) {
+    uint64_t flags;
+    asm volatile("mrs %0, DAIF\n\tmsr DAIFSet, #2" : "=r"(flags) :: "memory");
+    spin_lock(l);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *l, uint64_t flags) {
+    spin_unlock(l);
+    asm volatile("msr DAIF, %0" :: "r"(flags) : "memory");
+}
+
+#endif /* SPINLOCK_H */
@@ -0,0 +1,21 @@
+#ifndef STRING_H
+#define STRING_H
+
+#include <common.h>
+
+// ------------------------- lib/string -------------------------
+// Fast paths: Normal (cacheable) memory only, the MMU must be on
+void *memcpy(void *dst, const void *src, size_t n);
+void *memmove(void *dst, const void *src, size_t n);
+void *memset(void *dst, int c, size_t n);
+int memcmp(const void *a, const void *b, size_t n);
+
+// Bulk zeroing: DC ZVA once the MMU and D-cache are on, stp stores before that
+void memzero(void *dst, size_t size);
+void memzero_stp(void *dst, size_t size);
+
+// Safe variants: naturally aligned accesses only, for Device/uncached memory or before the MMU is on
+void memcpy_io(volatile void *dst, const volatile void *src, size_t n);
+void memset_io(volatile void *dst, int c, size_t n);
+
+#endif /* STRING_H */
@@ -16,11 +16,43 @@
 // Timer 1 Delay (1 sec)
 #define CLOCK_HZ            1000000
 
+// ARM Generic Timer physical count (per-core system register, no MMIO)
+static inline uint64_t get_cntpct() {
+    uint64_t ticks;
+    asm volatile("isb; mrs %0, CNTPCT_EL0" : "=r"(ticks) :: "memory");
+    return ticks;
+}
+
+// ARM Generic Timer frequency in Hz (set by the firmware)
+static inline uint64_t get_cntfrq() {
+    uint64_t freq;
+    asm volatile("mrs %0, CNTFRQ_EL0" : "=r"(freq));
+    return freq;
+}
+
+// ----------------------- Software Timers -----------------------
+// One-shot timers on a hierarchical wheel, multiplexed onto System Timer compare 1
+#define TIMER_POOL_SIZE     4096
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  8                       // 48 bits of microseconds: deadlines up to ~8.9 years out
+#define TIMER_MIN_DELTA_US  2                       // Closest to CLO a compare can be set and still match
+#define TIMER_MAX_DELTA_US  ((1u << 31) - 1)        // Farther deadlines take an intermediate wakeup (stays positive as int32_t)
+
+typedef void (*timer_callback_t)(void *ctx);
+
+// Returned by timer_add(): pool index + 1 in the low half, reuse generation in the high half. 0 = none.
+typedef uint32_t timer_handle_t;
+
 uint32_t get_timer32();
 uint64_t get_timer64();
 void timer_wait(int ms);
 void timer_init();
+timer_handle_t timer_add(uint64_t deadline_us, timer_callback_t callback, void *ctx);
+uint32_t timer_cancel(timer_handle_t handle);
+uint32_t timer_pending();
+uint64_t timer_wakeups();
 
-void handle_timer1();
+void handle_timer1(void *ctx);
 
 #endif /* TIMER_H */
\ No newline at end of file
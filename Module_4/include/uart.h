@@ -6,9 +6,11 @@
 #define HEX_STR(h) ((h < 10) ? '0' + h : 'A' + h - 10)
 
 #define INT_BUF_SIZE            10
+#define UINT_BUF_SIZE           20
 #define HEX_BUF_SIZE            18
 #define DESIRED_BAUD            115200
 #define UART_MAX_QUEUE          (16 * 1024)
+#define UART_RX_QUEUE           256         // Received bytes waiting for the deferred echo (power of two)
 
 // ------------------------- PL011 UART -------------------------
 #define UART0_BASE              0xFE201000
@@ -63,8 +65,11 @@ typedef enum {
 // ------------------------- UART Functions -------------------------
 // UART Write Functions
 void uart_writeByte(unsigned char ch);
+void uart_writeByteWait(unsigned char ch);
 void uart_writeInt(int num);
+void uart_writeUInt(uint64_t num);
 void uart_writeHex(long num);
+uint32_t uart_bufferEmpty();
 
 // UART 0
 void uart_writeText(char *text);
@@ -72,9 +77,10 @@ void uart_loadOutputBuffer();
 
 // UART 0 Interrupt
 void uart_init();
-void uart_handler();
+void uart_handler(void *ctx);
 void uart_tx_handler();
 void uart_rx_handler();
 void uart_rt_handler();
+void uart_crit_dump();
 void set_fifo_level(fifo_level_t rx_sel, fifo_level_t tx_sel);
 #endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef WAVE_H
+#define WAVE_H
+
+#include <common.h>
+
+// GPIO waveform engine on System Timer compare 3
+#define WAVE_MAX_STEPS          256
+#define WAVE_IRQ_PRIORITY       0x70    // Above the IPIs and timers: an edge is the tightest deadline here
+#define WAVE_LEAD_US            3       // C3 fires this early and the handler spins the rest of the way
+#define WAVE_SPIN_US            10      // A step this close is spun to in the same interrupt, not re-armed
+#define WAVE_START_DELAY_US     100     // First edge time 0 is this far after wave_start()
+
+// One edge: drive `pin` to `level` at `time_us` after the start of the waveform
+typedef struct {
+    uint32_t time_us;
+    uint8_t pin;
+    uint8_t level;
+} wave_edge_t;
+
+// Every edge on one microsecond, as one GPSET/GPCLR write per bank
+typedef struct {
+    uint32_t time_us;
+    uint32_t set[2];
+    uint32_t clr[2];
+} wave_step_t;
+
+typedef struct {
+    uint64_t steps;             // GPSET/GPCLR batches written
+    uint64_t interrupts;        // Compare 3 interrupts taken
+    uint64_t late_total;        // Microseconds between each step's time and its write
+    uint32_t late_max;
+} wave_stats_t;
+
+uint32_t wave_start(wave_edge_t *edges, uint32_t count, uint32_t period_us);
+void wave_stop();
+uint32_t wave_busy();
+void wave_get_stats(wave_stats_t *stats);
+void wave_reset_stats();
+
+#endif /* WAVE_H */
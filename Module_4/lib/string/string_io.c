@@ -0,0 +1,55 @@
+#include <string.h>
+
+#define WORD_MASK   (sizeof(uint32_t) - 1)
+
+/**
+ * Copies n bytes using only naturally aligned accesses. Uses 32-bit accesses when both
+ * pointers share word alignment, byte accesses otherwise.
+ */
+void memcpy_io(volatile void *dst, const volatile void *src, size_t n) {
+    volatile uint8_t *d = dst;
+    const volatile uint8_t *s = src;
+
+    if ((((uintptr_t)d ^ (uintptr_t)s) & WORD_MASK) == 0) {
+        // Bytes up to word alignment
+        while (n && ((uintptr_t)d & WORD_MASK)) {
+            *d++ = *s++;
+            n--;
+        }
+
+        while (n >= sizeof(uint32_t)) {
+            *(volatile uint32_t *)d = *(const volatile uint32_t *)s;
+            d += sizeof(uint32_t);
+            s += sizeof(uint32_t);
+            n -= sizeof(uint32_t);
+        }
+    }
+
+    while (n--) {
+        *d++ = *s++;
+    }
+}
+
+/**
+ * Fills n bytes with c using only naturally aligned accesses.
+ */
+void memset_io(volatile void *dst, int c, size_t n) {
+    volatile uint8_t *d = dst;
+    uint32_t word = (uint8_t)c * 0x01010101;
+
+    // Bytes up to word alignment
+    while (n && ((uintptr_t)d & WORD_MASK)) {
+        *d++ = (uint8_t)c;
+        n--;
+    }
+
+    while (n >= sizeof(uint32_t)) {
+        *(volatile uint32_t *)d = word;
+        d += sizeof(uint32_t);
+        n -= sizeof(uint32_t);
+    }
+
+    while (n--) {
+        *d++ = (uint8_t)c;
+    }
+}
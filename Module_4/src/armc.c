@@ -0,0 +1,77 @@
+#include <armc.h>
+#include <gpio.h>
+
+// First GIC interrupt ID of each pending/enable bank
+static const uint32_t armc_bank_base[ARMC_NUM_BANKS] = {
+    ARMC_VC_IRQ_BASE, ARMC_VC_IRQ_BASE + 32, ARMC_ARM_IRQ_BASE
+};
+
+/**
+ * Finds the bank and bit of a GIC interrupt ID. Returns 0 if the ARMC has no line for it
+ * (SGIs, PPIs and the GIC-only SPIs).
+ */
+static uint32_t armc_locate(uint32_t irq, uint32_t *bank, uint32_t *bit) {
+    if (irq >= ARMC_VC_IRQ_BASE && irq < ARMC_VC_IRQ_BASE + 64) {
+        *bank = (irq - ARMC_VC_IRQ_BASE) / 32;
+    } else if (irq >= ARMC_ARM_IRQ_BASE && irq < ARMC_ARM_IRQ_BASE + 16) {
+        *bank = 2;
+    } else {
+        return 0;
+    }
+
+    *bit = irq - armc_bank_base[*bank];
+    return 1;
+}
+
+/**
+ * Disables every ARMC source for core 0. Sources are enabled by irq_register().
+ */
+void armc_init() {
+    mmio_write((long)&IRQ0_REGS->IRQ0_DISABLE_0, 0xFFFFFFFF);
+    mmio_write((long)&IRQ0_REGS->IRQ0_DISABLE_1, 0xFFFFFFFF);
+    mmio_write((long)&IRQ0_REGS->IRQ0_DISABLE_2, ARMC_ARM_IRQ_MASK);
+}
+
+/**
+ * Routes a source to core 0's IRQ. The enable registers are write-1-to-set, so no read-modify-write.
+ * Returns 1 on success, 0 if the ARMC has no line for this ID.
+ */
+uint32_t armc_enable_interrupt(uint32_t irq) {
+    uint32_t bank, bit;
+
+    if (!armc_locate(irq, &bank, &bit)) {
+        return 0;
+    }
+
+    mmio_write((long)(&IRQ0_REGS->IRQ0_ENABLE_0 + bank), 1 << bit);
+    return 1;
+}
+
+void armc_disable_interrupt(uint32_t irq) {
+    uint32_t bank, bit;
+
+    if (armc_locate(irq, &bank, &bit)) {
+        mmio_write((long)(&IRQ0_REGS->IRQ0_DISABLE_0 + bank), 1 << bit);
+    }
+}
+
+/**
+ * Snapshots the enabled, pending sources. PENDING0/1 are only read when PENDING2's summary bits
+ * say they have something, so an idle bank costs nothing. Returns non-zero if anything is pending.
+ */
+uint32_t armc_read_pending(uint32_t pending[ARMC_NUM_BANKS]) {
+    uint32_t summary = mmio_read((long)&IRQ0_REGS->IRQ0_PENDING2);
+
+    pending[0] = (summary & ARMC_PENDING0_ANY) ? mmio_read((long)&IRQ0_REGS->IRQ0_PENDING0) : 0;
+    pending[1] = (summary & ARMC_PENDING1_ANY) ? mmio_read((long)&IRQ0_REGS->IRQ0_PENDING1) : 0;
+    pending[2] = summary & ARMC_ARM_IRQ_MASK;
+
+    return pending[0] | pending[1] | pending[2];
+}
+
+/**
+ * First GIC interrupt ID of a pending bank, for turning a bit index back into an ID.
+ */
+uint32_t armc_bank_irq(uint32_t bank) {
+    return armc_bank_base[bank];
+}
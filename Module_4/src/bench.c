@@ -0,0 +1,1071 @@
+#include <bench.h>
+#include <pmu.h>
+#include <uart.h>
+#include <string.h>
+#include <page_alloc.h>
+#include <kmem.h>
+#include <timer.h>
+#include <irq.h>
+#include <gic.h>
+#include <gpio.h>
+#include <softirq.h>
+#include <ipi.h>
+#include <smp.h>
+#include <critical.h>
+#include <latency.h>
+#include <local_timer.h>
+#include <clocksource.h>
+#include <idle.h>
+#include <wave.h>
+#include <capture.h>
+
+#define CACHE_BENCH_SIZE    (64 * 1024)
+#define CACHE_BENCH_PASSES  16
+#define ZERO_BENCH_SIZE     (256 * 1024)
+#define STRING_BENCH_MIN    8
+#define STRING_BENCH_ORDER  11                  // 8MB buffers from the page allocator
+#define STRING_BENCH_MAX    PAGE_ORDER_SIZE(STRING_BENCH_ORDER)
+#define STRING_BENCH_TOTAL  (16 * 1024 * 1024)  // Bytes processed per size and routine
+#define KMEM_BENCH_ITERS    100000
+#define KMEM_BENCH_BATCH    256                 // Live objects in the batch pattern (forces refill/flush)
+#define KMEM_STRESS_SLOTS   512
+#define KMEM_STRESS_ITERS   200000
+#define NEST_FLOOD_PRIO     0xB0                // Below the timer (0x90) and UART (0xA0)
+#define NEST_FLOOD_ITEMS    200
+#define NEST_FLOOD_US       500                 // Handler time per flood interrupt, like a long UART drain
+#define NEST_PROBE_PRIO     0x80
+#define NEST_PROBE_US       97                  // Latency probe period on System Timer C3
+#define NEST_UART_LINES     32                  // Console lines the UART TX interrupt drains per run
+#define NEST_TICK_US        97                  // Software timer period in the UART run
+#define ENTRY_BENCH_ITERS   1000
+#define FIQ_BENCH_PRIO      0x40
+#define DEFER_BENCH_PRIO    0xA8
+#define DEFER_BENCH_ITERS   100
+#define DEFER_BENCH_WORK_US 200                 // Work per interrupt, like echoing a burst of RX bytes
+#define IPI_BENCH_ITERS     1000
+#define AFFINITY_BENCH_PRIO 0xA8
+#define CRIT_BENCH_PRIO     0xA0                // The UART's level
+#define CRIT_BENCH_HOLD_US  2000                // Critical section length
+#define CRIT_BENCH_FIRE_US  500                 // Probe fires this long into the section
+#define TIMER_BENCH_COUNT   4000                // Timers pending at once in the insert/cancel run
+#define TIMER_BENCH_SPREAD  10000000            // Their deadlines are spread over the next 10 s
+#define TIMER_BENCH_FIRES   200                 // Timers that are left to fire in the accuracy run
+#define TIMER_BENCH_STEP_US 137
+#define TIMER_BENCH_IDLE_MS 100
+#define LOCAL_BENCH_READS   10000
+#define LOCAL_BENCH_SHOTS   100
+#define LOCAL_BENCH_SHOT_US 50
+#define LOCAL_BENCH_TICK_US 1000
+#define IDLE_BENCH_MS       100
+#define WAVE_SERVO_PIN_A    17
+#define WAVE_SERVO_PIN_B    27
+#define WAVE_SERVO_PERIOD   20000               // 50 Hz servo frame
+#define WAVE_SERVO_FRAMES   10
+#define WAVE_BURST_PIN      22
+#define WAVE_BURST_EDGES    100
+#define WAVE_BURST_STEP_US  20                  // Closer than WAVE_SPIN_US + a compare re-arm
+#define CAPTURE_BENCH_CPU   3
+#define CAPTURE_BENCH_BATCH 64
+
+// The interrupt benchmarks pend unconnected SPIs or send SGIs, which only the GIC can do
+#ifdef NO_GIC
+#define BENCH_GIC           0
+#else
+#define BENCH_GIC           1
+#endif
+
+static uint32_t cache_bench_buf[CACHE_BENCH_SIZE / 4];
+static uint8_t __attribute__((aligned(CACHE_LINE_SIZE))) zero_bench_buf[ZERO_BENCH_SIZE];
+
+static volatile uint32_t nest_flood_left;
+static volatile uint32_t nest_probe_target;
+static uint32_t nest_probe_samples;
+static uint32_t nest_probe_total;
+static uint32_t nest_probe_max;
+static volatile uint32_t nest_tick_running;
+static uint64_t nest_tick_deadline;
+static volatile uint64_t entry_bench_stamp;
+static volatile uint32_t defer_bench_done;
+static uint32_t defer_bench_deferred;
+static volatile uint32_t ipi_bench_pongs;
+static volatile uint32_t timer_bench_fired;
+static uint32_t timer_bench_late_total;
+static uint32_t timer_bench_late_max;
+static volatile uint64_t local_bench_stamp;
+static volatile uint32_t affinity_bench_cpu;
+
+/**
+ * Prints one benchmark result as "name: cycles [, bytes/cycle]" over UART.
+ */
+void bench_report(char *name, uint64_t cycles, uint64_t bytes) {
+    uart_writeText(name);
+    uart_writeText(": ");
+    uart_writeUInt(cycles);
+    uart_writeText(" cycles");
+
+    if (bytes && cycles) {
+        uint64_t hundredths = (bytes * 100) / cycles;
+
+        uart_writeText(", ");
+        uart_writeUInt(hundredths / 100);
+        uart_writeByte('.');
+        uart_writeByte('0' + (hundredths / 10) % 10);
+        uart_writeByte('0' + hundredths % 10);
+        uart_writeText(" bytes/cycle");
+    }
+    uart_writeText("\n");
+}
+
+/**
+ * Fixed memory workload: fill a 64KB buffer and sum it back with a ring-buffer style
+ * modulo index. Compare a default build against `make MMU=0` to see the cache speedup.
+ */
+static void bench_cache() {
+    uint32_t n = CACHE_BENCH_SIZE / 4;
+    uint32_t sum = 0;
+
+    uint64_t start = pmu_cycles();
+    for (int pass = 0; pass < CACHE_BENCH_PASSES; pass++) {
+        for (uint32_t i = 0; i < n; i++) {
+            cache_bench_buf[i] = i ^ pass;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            sum += cache_bench_buf[(i * 7) % n];
+        }
+    }
+    uint64_t cycles = pmu_cycles() - start;
+
+    bench_report("cache workload", cycles, (uint64_t)CACHE_BENCH_SIZE * 2 * CACHE_BENCH_PASSES);
+
+    // Keep the result live
+    uart_writeText("checksum: ");
+    uart_writeHex(sum);
+    uart_writeText("\n");
+}
+
+/**
+ * Zeroes the same buffer with the store-only path and with memzero() (DC ZVA when the caches are on).
+ */
+static void bench_memzero() {
+    uint64_t start = pmu_cycles();
+    memzero_stp(zero_bench_buf, ZERO_BENCH_SIZE);
+    bench_report("memzero stp", pmu_cycles() - start, ZERO_BENCH_SIZE);
+
+    start = pmu_cycles();
+    memzero(zero_bench_buf, ZERO_BENCH_SIZE);
+    bench_report("memzero zva", pmu_cycles() - start, ZERO_BENCH_SIZE);
+}
+
+/**
+ * Throughput of the lib/string routines from 8 B to 8 MB (x4 steps).
+ */
+static void bench_string() {
+    uint8_t *src = page_alloc(STRING_BENCH_ORDER);
+    uint8_t *dst = page_alloc(STRING_BENCH_ORDER);
+    volatile int sink = 0;
+
+    if (src == NULL || dst == NULL) {
+        uart_writeText("string bench: out of memory\n");
+        page_free(src, STRING_BENCH_ORDER);
+        page_free(dst, STRING_BENCH_ORDER);
+        return;
+    }
+
+    for (size_t size = STRING_BENCH_MIN; size <= STRING_BENCH_MAX; size *= 4) {
+        uint64_t iters = STRING_BENCH_TOTAL / size;
+        uint64_t bytes = iters * size;
+        uint64_t start;
+
+        uart_writeText("size ");
+        uart_writeUInt(size);
+        uart_writeText("\n");
+
+        start = pmu_cycles();
+        for (uint64_t i = 0; i < iters; i++) {
+            memset(src, (int)i, size);
+        }
+        bench_report("  memset", pmu_cycles() - start, bytes);
+
+        start = pmu_cycles();
+        for (uint64_t i = 0; i < iters; i++) {
+            memcpy(dst, src, size);
+        }
+        bench_report("  memcpy", pmu_cycles() - start, bytes);
+
+        // Buffers are equal here, so memcmp walks the full length
+        start = pmu_cycles();
+        for (uint64_t i = 0; i < iters; i++) {
+            sink += memcmp(dst, src, size);
+        }
+        bench_report("  memcmp", pmu_cycles() - start, bytes);
+
+        // Overlapping move, takes the backward path
+        start = pmu_cycles();
+        for (uint64_t i = 0; i < iters; i++) {
+            memmove(dst + 1, dst, size - 1);
+        }
+        bench_report("  memmove", pmu_cycles() - start, bytes);
+    }
+
+    if (sink) {
+        uart_writeText("memcmp mismatch\n");
+    }
+
+    page_free(src, STRING_BENCH_ORDER);
+    page_free(dst, STRING_BENCH_ORDER);
+}
+
+/**
+ * Prints an allocation rate in allocations per second from CNTPCT ticks.
+ */
+static void bench_report_rate(char *name, uint64_t allocs, uint64_t ticks) {
+    uart_writeText(name);
+    uart_writeText(": ");
+    uart_writeUInt(ticks ? (allocs * get_cntfrq()) / ticks : 0);
+    uart_writeText(" allocs/s\n");
+}
+
+/**
+ * Small xorshift generator for the stress patterns.
+ */
+static uint32_t bench_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * Slab allocator throughput per size class (alloc/free pairs served by the magazine, then
+ * batches large enough to go through refill/flush), and a randomized stress run that fills
+ * every object with a tag and checks it is intact when the object is freed.
+ */
+static void bench_kmem() {
+    static void *batch[KMEM_BENCH_BATCH];
+    static void *slots[KMEM_STRESS_SLOTS];
+    static uint32_t sizes[KMEM_STRESS_SLOTS];
+
+    for (uint32_t shift = KMEM_MIN_SHIFT; shift <= KMEM_MAX_SHIFT; shift++) {
+        size_t size = 1 << shift;
+
+        uart_writeText("kmalloc ");
+        uart_writeUInt(size);
+        uart_writeText("\n");
+
+        uint64_t start = get_cntpct();
+        for (uint32_t i = 0; i < KMEM_BENCH_ITERS; i++) {
+            kfree(kmalloc(size));
+        }
+        bench_report_rate("  pair", KMEM_BENCH_ITERS, get_cntpct() - start);
+
+        start = get_cntpct();
+        for (uint32_t i = 0; i < KMEM_BENCH_ITERS; i += KMEM_BENCH_BATCH) {
+            for (uint32_t j = 0; j < KMEM_BENCH_BATCH; j++) {
+                batch[j] = kmalloc(size);
+            }
+            for (uint32_t j = 0; j < KMEM_BENCH_BATCH; j++) {
+                kfree(batch[j]);
+            }
+        }
+        bench_report_rate("  batch", KMEM_BENCH_ITERS, get_cntpct() - start);
+    }
+
+    // Stress: random sizes, random replacement, tag check on every free
+    uint32_t seed = 0x12345678;
+    uint32_t errors = 0, failed = 0;
+
+    for (uint32_t i = 0; i < KMEM_STRESS_ITERS; i++) {
+        uint32_t slot = bench_rand(&seed) % KMEM_STRESS_SLOTS;
+
+        if (slots[slot]) {
+            uint8_t *obj = slots[slot];
+            for (uint32_t j = 0; j < sizes[slot]; j++) {
+                errors += (obj[j] != (uint8_t)slot);
+            }
+            kfree(obj);
+            slots[slot] = NULL;
+        } else {
+            sizes[slot] = 1 + bench_rand(&seed) % (1 << KMEM_MAX_SHIFT);
+            slots[slot] = kmalloc(sizes[slot]);
+
+            if (slots[slot]) {
+                memset(slots[slot], (uint8_t)slot, sizes[slot]);
+            } else {
+                failed++;
+            }
+        }
+    }
+
+    for (uint32_t slot = 0; slot < KMEM_STRESS_SLOTS; slot++) {
+        kfree(slots[slot]);
+        slots[slot] = NULL;
+    }
+
+    uart_writeText("kmem stress: ");
+    uart_writeInt(errors);
+    uart_writeText(" corrupted bytes, ");
+    uart_writeInt(failed);
+    uart_writeText(" failed allocs\n");
+    kmem_dump();
+}
+
+/**
+ * Low priority flood source: busy for NEST_FLOOD_US, then re-pends itself until the flood is done.
+ */
+static void nest_flood_handler(void *ctx) {
+    uint32_t start = get_timer32();
+    while (get_timer32() - start < NEST_FLOOD_US) {
+        // Simulated device drain
+    }
+
+    if (--nest_flood_left) {
+        set_pending(BENCH_IRQ_NEST_FLOOD);
+    }
+}
+
+/**
+ * High priority probe on System Timer C3: records compare-to-handler latency in microseconds.
+ */
+static void nest_probe_handler(void *ctx) {
+    uint32_t now = get_timer32();
+    uint32_t latency = now - nest_probe_target;
+
+    mmio_write(SYS_TIMER_CS, 1 << 3);
+
+    nest_probe_samples++;
+    nest_probe_total += latency;
+    if (latency > nest_probe_max) {
+        nest_probe_max = latency;
+    }
+
+    if (nest_flood_left) {
+        nest_probe_target = now + NEST_PROBE_US;
+        mmio_write(SYS_TIMER_C3, nest_probe_target);
+    }
+}
+
+/**
+ * Measures timer latency while a flood of long, lower priority interrupts is serviced,
+ * with nesting off (depth 1) and at the default limit. With nesting the worst case stays
+ * at a few microseconds instead of growing to the length of one flood handler.
+ */
+static void bench_irq_nesting() {
+    uint32_t depths[2] = { 1, IRQ_MAX_NESTING };
+
+    irq_register(BENCH_IRQ_NEST_FLOOD, nest_flood_handler, NULL, NEST_FLOOD_PRIO, edge_triggered);
+    irq_register(SYS_TIMER_IRQ_3, nest_probe_handler, NULL, NEST_PROBE_PRIO, edge_triggered);
+
+    for (uint32_t i = 0; i < 2; i++) {
+        irq_set_max_nesting(depths[i]);
+        nest_probe_samples = 0;
+        nest_probe_total = 0;
+        nest_probe_max = 0;
+        nest_flood_left = NEST_FLOOD_ITEMS;
+
+        nest_probe_target = get_timer32() + NEST_PROBE_US;
+        mmio_write(SYS_TIMER_C3, nest_probe_target);
+        set_pending(BENCH_IRQ_NEST_FLOOD);
+
+        while (nest_flood_left) {
+            // The flood runs in IRQ context
+        }
+        timer_wait(1);  // Let the last probe fire
+
+        uart_writeText("irq nesting depth ");
+        uart_writeUInt(depths[i]);
+        uart_writeText(": timer latency avg ");
+        uart_writeUInt(nest_probe_samples ? nest_probe_total / nest_probe_samples : 0);
+        uart_writeText(" us, max ");
+        uart_writeUInt(nest_probe_max);
+        uart_writeText(" us over ");
+        uart_writeUInt(nest_probe_samples);
+        uart_writeText(" samples\n");
+    }
+
+    irq_unregister(SYS_TIMER_IRQ_3);
+    irq_unregister(BENCH_IRQ_NEST_FLOOD);
+    irq_set_max_nesting(IRQ_MAX_NESTING);
+}
+
+/**
+ * Software timer (System Timer compare 1, the tick's priority): records how late it ran, as the
+ * C3 probe does, and re-arms itself until the UART has drained.
+ */
+static void nest_tick_handler(void *ctx) {
+    uint64_t now = get_timer64();
+    uint32_t latency = now - nest_tick_deadline;
+
+    nest_probe_samples++;
+    nest_probe_total += latency;
+    if (latency > nest_probe_max) {
+        nest_probe_max = latency;
+    }
+
+    if (nest_tick_running) {
+        nest_tick_deadline = now + NEST_TICK_US;
+        timer_add(nest_tick_deadline, nest_tick_handler, NULL);
+    }
+}
+
+/**
+ * The same comparison with the real sources: software timer latency while the UART TX interrupt
+ * drains NEST_UART_LINES lines of console output.
+ */
+static void bench_irq_nesting_uart() {
+    uint32_t depths[2] = { 1, IRQ_MAX_NESTING };
+
+    for (uint32_t i = 0; i < 2; i++) {
+        irq_set_max_nesting(depths[i]);
+        nest_probe_samples = 0;
+        nest_probe_total = 0;
+        nest_probe_max = 0;
+
+        nest_tick_running = 1;
+        nest_tick_deadline = get_timer64() + NEST_TICK_US;
+        timer_add(nest_tick_deadline, nest_tick_handler, NULL);
+
+        for (uint32_t line = 0; line < NEST_UART_LINES; line++) {
+            uart_writeText("................................................................\n");
+        }
+        while (!uart_bufferEmpty()) {
+            // Drained by the TX interrupt
+        }
+        nest_tick_running = 0;
+        timer_wait(1);  // Let the last tick fire
+
+        uart_writeText("irq nesting depth ");
+        uart_writeUInt(depths[i]);
+        uart_writeText(": tick latency under uart tx avg ");
+        uart_writeUInt(nest_probe_samples ? nest_probe_total / nest_probe_samples : 0);
+        uart_writeText(" us, max ");
+        uart_writeUInt(nest_probe_max);
+        uart_writeText(" us over ");
+        uart_writeUInt(nest_probe_samples);
+        uart_writeText(" samples\n");
+    }
+
+    irq_set_max_nesting(IRQ_MAX_NESTING);
+}
+
+/**
+ * Entry benchmark handler: stamps the cycle counter as soon as the C handler runs.
+ */
+static void entry_bench_handler(void *ctx) {
+    entry_bench_stamp = pmu_cycles();
+}
+
+/**
+ * Cycles from pending a software SPI to its C handler, and back to the interrupted code.
+ * Both numbers include the distributor's signalling latency, which is the same for every path.
+ */
+static void bench_pend_latency(char *name, uint32_t irq) {
+    uint64_t entry_min = ~0ULL, entry_total = 0;
+    uint64_t round_min = ~0ULL, round_total = 0;
+
+    for (uint32_t i = 0; i < ENTRY_BENCH_ITERS; i++) {
+        entry_bench_stamp = 0;
+
+        uint64_t start = pmu_cycles();
+        set_pending(irq);
+        while (entry_bench_stamp == 0) {
+            // Taken as soon as the distributor forwards it
+        }
+        uint64_t round = pmu_cycles() - start;
+        uint64_t entry = entry_bench_stamp - start;
+
+        entry_total += entry;
+        round_total += round;
+        if (entry < entry_min) {
+            entry_min = entry;
+        }
+        if (round < round_min) {
+            round_min = round;
+        }
+    }
+
+    uart_writeText(name);
+    uart_writeText("\n  pend to handler: min ");
+    uart_writeUInt(entry_min);
+    uart_writeText(", avg ");
+    uart_writeUInt(entry_total / ENTRY_BENCH_ITERS);
+    uart_writeText(" cycles\n  round trip: min ");
+    uart_writeUInt(round_min);
+    uart_writeText(", avg ");
+    uart_writeUInt(round_total / ENTRY_BENCH_ITERS);
+    uart_writeText(" cycles\n");
+}
+
+/**
+ * IRQ entry cost. Build with `make BENCH=1 IRQ_FULL_FRAME=1` for the full 31-register frame to compare against.
+ */
+static void bench_irq_entry() {
+    irq_register(BENCH_IRQ_ENTRY, entry_bench_handler, NULL, NEST_PROBE_PRIO, edge_triggered);
+#ifdef IRQ_FULL_FRAME
+    bench_pend_latency("irq entry (full frame)", BENCH_IRQ_ENTRY);
+#else
+    bench_pend_latency("irq entry (reduced frame)", BENCH_IRQ_ENTRY);
+#endif
+    irq_unregister(BENCH_IRQ_ENTRY);
+}
+
+/**
+ * Same measurement through the FIQ path, to compare against bench_irq_entry().
+ */
+static void bench_fiq_entry() {
+    if (!fiq_register(BENCH_IRQ_FIQ, entry_bench_handler, NULL, FIQ_BENCH_PRIO, edge_triggered)) {
+        uart_writeText("fiq entry: unavailable (GIC Group 0 is Secure-only)\n");
+        return;
+    }
+
+    bench_pend_latency("fiq entry", BENCH_IRQ_FIQ);
+    fiq_unregister();
+}
+
+/**
+ * The softirq benchmark's workload: DEFER_BENCH_WORK_US of busy time, inline or as deferred work.
+ */
+static void defer_bench_work(void *arg) {
+    uint32_t start = get_timer32();
+    while (get_timer32() - start < DEFER_BENCH_WORK_US) {
+        // Simulated bottom half
+    }
+    defer_bench_done++;
+}
+
+/**
+ * Runs the workload in the handler, or queues it with softirq_raise() in the deferred pass.
+ */
+static void defer_bench_handler(void *ctx) {
+    if (defer_bench_deferred) {
+        softirq_raise(defer_bench_work, NULL);
+    } else {
+        defer_bench_work(NULL);
+    }
+}
+
+/**
+ * Longest IRQ-off span with the work done inside the handler, then deferred with softirq_raise().
+ */
+static void bench_softirq() {
+    irq_register(BENCH_IRQ_DEFER, defer_bench_handler, NULL, DEFER_BENCH_PRIO, edge_triggered);
+
+    for (defer_bench_deferred = 0; defer_bench_deferred < 2; defer_bench_deferred++) {
+        irq_reset_max_off();
+        defer_bench_done = 0;
+
+        for (uint32_t i = 0; i < DEFER_BENCH_ITERS; i++) {
+            set_pending(BENCH_IRQ_DEFER);
+            while (defer_bench_done == i) {
+                // Runs in the IRQ, or at its exit with IRQs enabled
+            }
+        }
+
+        uart_writeText(defer_bench_deferred ? "softirq deferred" : "softirq inline");
+        uart_writeText(": max IRQ-off ");
+        uart_writeUInt(irq_max_off_cycles());
+        uart_writeText(" cycles\n");
+    }
+
+    irq_unregister(BENCH_IRQ_DEFER);
+    softirq_dump();
+}
+
+/**
+ * IPI_PING handler: secondaries bounce the ping straight back to core 0.
+ */
+static void ipi_bench_handler(void *ctx) {
+    if (smp_cpu_id() == 0) {
+        ipi_bench_pongs++;
+    } else {
+        ipi_send(1 << 0, IPI_PING);
+    }
+}
+
+/**
+ * Cross-core IPI round trip: core 0 pings each online secondary and waits for the reply.
+ */
+static void bench_ipi() {
+    ipi_register(IPI_PING, ipi_bench_handler, NULL);
+
+    for (uint32_t cpu = 1; cpu < NUM_CORES; cpu++) {
+        if (!percpu_data[cpu].online) {
+            continue;
+        }
+
+        uint64_t min = ~0ULL, total = 0;
+        for (uint32_t i = 0; i < IPI_BENCH_ITERS; i++) {
+            uint32_t pongs = ipi_bench_pongs;
+
+            uint64_t start = pmu_cycles();
+            ipi_send(1 << cpu, IPI_PING);
+            while (ipi_bench_pongs == pongs) {
+                // Core 0 takes the pong in its IRQ handler
+            }
+            uint64_t cycles = pmu_cycles() - start;
+
+            total += cycles;
+            if (cycles < min) {
+                min = cycles;
+            }
+        }
+
+        uart_writeText("ipi ping-pong cpu 0 <-> ");
+        uart_writeInt(cpu);
+        uart_writeText(": min ");
+        uart_writeUInt(min);
+        uart_writeText(", avg ");
+        uart_writeUInt(total / IPI_BENCH_ITERS);
+        uart_writeText(" cycles\n");
+    }
+
+    ipi_unregister(IPI_PING);
+}
+
+/**
+ * Records which core the routed SPI was taken on.
+ */
+static void affinity_bench_handler(void *ctx) {
+    affinity_bench_cpu = smp_cpu_id();
+}
+
+/**
+ * Routes a software SPI to each online core in turn, checks the read-back routing and the core
+ * the handler actually ran on, then lets the balancer place it.
+ */
+static void bench_irq_affinity() {
+    irq_register(BENCH_IRQ_AFFINITY, affinity_bench_handler, NULL, AFFINITY_BENCH_PRIO, edge_triggered);
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        if (!irq_set_affinity(BENCH_IRQ_AFFINITY, 1 << cpu)) {
+            continue;
+        }
+
+        affinity_bench_cpu = NUM_CORES;
+        set_pending(BENCH_IRQ_AFFINITY);
+        uint32_t start = get_timer32();
+        while (affinity_bench_cpu == NUM_CORES && get_timer32() - start < 1000) {
+            // Handled on the target core
+        }
+
+        uart_writeText("irq affinity cpu ");
+        uart_writeInt(cpu);
+        uart_writeText(": routing ");
+        uart_writeHex(irq_get_affinity(BENCH_IRQ_AFFINITY));
+        uart_writeText(", handled on cpu ");
+        uart_writeInt(affinity_bench_cpu);
+        uart_writeText("\n");
+    }
+
+    irq_unpin(BENCH_IRQ_AFFINITY);
+    uart_writeText("irq balance: moved ");
+    uart_writeUInt(irq_balance());
+    uart_writeText(" lines\n");
+
+    irq_unregister(BENCH_IRQ_AFFINITY);
+}
+
+/**
+ * Holds a 2 ms section masked at the UART's level with GICC_PMR, then with PSTATE.I, while the
+ * C3 probe (above the UART) fires inside it. Only the DAIF version delays the probe.
+ */
+static void bench_crit() {
+    static crit_section_t bench_crit_section = CRIT_SECTION_INIT("bench pmr section", CRIT_BENCH_PRIO);
+
+    irq_register(SYS_TIMER_IRQ_3, nest_probe_handler, NULL, NEST_PROBE_PRIO, edge_triggered);
+    nest_flood_left = 0;    // One probe per section
+
+    for (uint32_t i = 0; i < 2; i++) {
+        uint32_t use_pmr = (i == 0);
+
+        nest_probe_samples = 0;
+        nest_probe_total = 0;
+        nest_probe_max = 0;
+
+        nest_probe_target = get_timer32() + CRIT_BENCH_FIRE_US;
+        mmio_write(SYS_TIMER_C3, nest_probe_target);
+
+        crit_state_t state;
+        uint64_t flags = 0;
+        if (use_pmr) {
+            state = crit_enter(&bench_crit_section);
+        } else {
+            flags = irq_save();
+        }
+
+        uint32_t start = get_timer32();
+        while (get_timer32() - start < CRIT_BENCH_HOLD_US) {
+            // Protected work
+        }
+
+        if (use_pmr) {
+            crit_exit(&bench_crit_section, state);
+        } else {
+            irq_restore(flags);
+        }
+        timer_wait(1);
+
+        uart_writeText(use_pmr ? "pmr section" : "daif section");
+        uart_writeText(": timer latency ");
+        uart_writeUInt(nest_probe_max);
+        uart_writeText(" us\n");
+    }
+
+    irq_unregister(SYS_TIMER_IRQ_3);
+    crit_dump(&bench_crit_section);
+    uart_crit_dump();
+}
+
+/**
+ * Software timer callback: ctx is the low 32 bits of its deadline.
+ */
+static void timer_bench_callback(void *ctx) {
+    uint32_t late = get_timer32() - (uint32_t)(uintptr_t)ctx;
+
+    timer_bench_late_total += late;
+    if (late > timer_bench_late_max) {
+        timer_bench_late_max = late;
+    }
+    timer_bench_fired++;
+}
+
+/**
+ * Software timers: insert and cancel cost with TIMER_BENCH_COUNT pending, lateness of timers that
+ * fire, and compare 1 wakeups over an idle stretch with nothing pending.
+ */
+static void bench_timer() {
+    static timer_handle_t handles[TIMER_BENCH_COUNT];
+    uint32_t seed = 0x2545F491;
+    uint64_t now = get_timer64();
+
+    uint64_t start = pmu_cycles();
+    for (uint32_t i = 0; i < TIMER_BENCH_COUNT; i++) {
+        uint64_t deadline = now + 1000000 + bench_rand(&seed) % TIMER_BENCH_SPREAD;
+        handles[i] = timer_add(deadline, timer_bench_callback, (void *)(uintptr_t)(uint32_t)deadline);
+    }
+    uint64_t add_cycles = pmu_cycles() - start;
+
+    start = pmu_cycles();
+    for (uint32_t i = 0; i < TIMER_BENCH_COUNT; i++) {
+        timer_cancel(handles[i]);
+    }
+    uint64_t cancel_cycles = pmu_cycles() - start;
+
+    uart_writeText("timer_add: ");
+    uart_writeUInt(add_cycles / TIMER_BENCH_COUNT);
+    uart_writeText(" cycles, timer_cancel: ");
+    uart_writeUInt(cancel_cycles / TIMER_BENCH_COUNT);
+    uart_writeText(" cycles (");
+    uart_writeUInt(TIMER_BENCH_COUNT);
+    uart_writeText(" pending)\n");
+
+    timer_bench_fired = 0;
+    timer_bench_late_total = 0;
+    timer_bench_late_max = 0;
+    now = get_timer64();
+    for (uint32_t i = 0; i < TIMER_BENCH_FIRES; i++) {
+        uint64_t deadline = now + 1000 + i * TIMER_BENCH_STEP_US;
+        timer_add(deadline, timer_bench_callback, (void *)(uintptr_t)(uint32_t)deadline);
+    }
+    while (timer_bench_fired < TIMER_BENCH_FIRES) {
+        // Callbacks run from the compare 1 interrupt
+    }
+
+    uart_writeText("timer lateness: avg ");
+    uart_writeUInt(timer_bench_late_total / TIMER_BENCH_FIRES);
+    uart_writeText(" us, max ");
+    uart_writeUInt(timer_bench_late_max);
+    uart_writeText(" us\n");
+
+    uint64_t wakeups = timer_wakeups();
+    timer_wait(TIMER_BENCH_IDLE_MS);
+    uart_writeText("timer wakeups while idle: ");
+    uart_writeUInt(timer_wakeups() - wakeups);
+    uart_writeText(" (");
+    uart_writeUInt(timer_pending());
+    uart_writeText(" pending)\n");
+}
+
+/**
+ * Cost of a timestamp from each clock, and a monotonicity check of now_ns() across the run.
+ */
+static void bench_clocksource() {
+    clocksource_dump();
+
+    uint64_t start = pmu_cycles();
+    for (uint32_t i = 0; i < LOCAL_BENCH_READS; i++) {
+        now_ns();
+    }
+    uint64_t ns_cycles = pmu_cycles() - start;
+
+    start = pmu_cycles();
+    for (uint32_t i = 0; i < LOCAL_BENCH_READS; i++) {
+        get_timer64();
+    }
+    uint64_t bcm_cycles = pmu_cycles() - start;
+
+    uint32_t backwards = 0;
+    uint64_t prev = now_ns();
+    for (uint32_t i = 0; i < LOCAL_BENCH_READS; i++) {
+        uint64_t now = now_ns();
+        backwards += now < prev;
+        prev = now;
+    }
+
+    uart_writeText("now_ns: ");
+    uart_writeUInt(ns_cycles / LOCAL_BENCH_READS);
+    uart_writeText(" cycles, get_timer64: ");
+    uart_writeUInt(bcm_cycles / LOCAL_BENCH_READS);
+    uart_writeText(" cycles, backwards steps: ");
+    uart_writeUInt(backwards);
+    uart_writeText("\n");
+}
+
+/**
+ * CNTP one-shot callback: stamps CNTPCT on entry, for the lateness against its deadline.
+ */
+static void local_bench_handler(void *ctx) {
+    local_bench_stamp = get_cntpct();
+}
+
+/**
+ * CNTPCT vs System Timer clock reads, CNTP vs compare register programming, one-shot lateness
+ * of this core's CNTP timer, and its tick count over 100 ms.
+ */
+static void bench_local_timer() {
+    uint64_t start = pmu_cycles();
+    for (uint32_t i = 0; i < LOCAL_BENCH_READS; i++) {
+        get_cntpct();
+    }
+    uint64_t cntpct_cycles = pmu_cycles() - start;
+
+    start = pmu_cycles();
+    for (uint32_t i = 0; i < LOCAL_BENCH_READS; i++) {
+        get_timer32();
+    }
+    uint64_t clo_cycles = pmu_cycles() - start;
+
+    uart_writeText("clock read: CNTPCT ");
+    uart_writeUInt(cntpct_cycles / LOCAL_BENCH_READS);
+    uart_writeText(" cycles, CLO ");
+    uart_writeUInt(clo_cycles / LOCAL_BENCH_READS);
+    uart_writeText(" cycles\n");
+
+    if (!BENCH_GIC) {
+        uart_writeText("local timer: unavailable (NO_GIC)\n");
+        return;
+    }
+
+    // Compare 3 is free here; compare 1 belongs to the software timers. Both are set a full wrap away.
+    uint32_t c3 = get_timer32() - 1;
+    start = pmu_cycles();
+    for (uint32_t i = 0; i < LOCAL_BENCH_READS; i++) {
+        cntp_write_cval(~0ULL);
+    }
+    uint64_t cval_cycles = pmu_cycles() - start;
+
+    start = pmu_cycles();
+    for (uint32_t i = 0; i < LOCAL_BENCH_READS; i++) {
+        mmio_write(SYS_TIMER_C3, c3);
+    }
+    uint64_t c3_cycles = pmu_cycles() - start;
+
+    uart_writeText("program deadline: CNTP_CVAL ");
+    uart_writeUInt(cval_cycles / LOCAL_BENCH_READS);
+    uart_writeText(" cycles, System Timer C3 ");
+    uart_writeUInt(c3_cycles / LOCAL_BENCH_READS);
+    uart_writeText(" cycles\n");
+
+    local_timer_set_handler(local_bench_handler, NULL);
+
+    uint64_t late_total = 0;
+    uint64_t late_max = 0;
+    for (uint32_t i = 0; i < LOCAL_BENCH_SHOTS; i++) {
+        uint64_t deadline = get_cntpct() + local_timer_us_to_ticks(LOCAL_BENCH_SHOT_US);
+
+        local_bench_stamp = 0;
+        local_timer_at(deadline);
+        while (local_bench_stamp == 0) {
+            // Fires on this core
+        }
+
+        uint64_t late = local_bench_stamp - deadline;
+        late_total += late;
+        if (late > late_max) {
+            late_max = late;
+        }
+    }
+
+    uart_writeText("local timer one-shot lateness: avg ");
+    uart_writeUInt(clock_ticks_to_ns(late_total / LOCAL_BENCH_SHOTS));
+    uart_writeText(" ns, max ");
+    uart_writeUInt(clock_ticks_to_ns(late_max));
+    uart_writeText(" ns\n");
+
+    uint64_t fired = local_timer_fired();
+    local_timer_start_tick(LOCAL_BENCH_TICK_US);
+    timer_wait(100);
+    local_timer_stop();
+    local_timer_set_handler(NULL, NULL);
+
+    uart_writeText("local timer ticks in 100 ms: ");
+    uart_writeUInt(local_timer_fired() - fired);
+    uart_writeText("\n");
+}
+
+/**
+ * Idle residency while core 0 sleeps in timer_wait(), then while it spins for as long.
+ */
+static void bench_idle() {
+    uart_writeText("sleeping ");
+    uart_writeUInt(IDLE_BENCH_MS);
+    uart_writeText(" ms:\n");
+    idle_reset();
+    timer_wait(IDLE_BENCH_MS);
+    idle_dump();
+
+    uart_writeText("spinning ");
+    uart_writeUInt(IDLE_BENCH_MS);
+    uart_writeText(" ms:\n");
+    idle_reset();
+    uint64_t end = now_ns() + IDLE_BENCH_MS * 1000000ULL;
+    while (now_ns() < end) {
+        // Busy
+    }
+    idle_dump();
+}
+
+/**
+ * Prints the waveform engine's step, interrupt and lateness counters.
+ */
+static void bench_wave_report(char *name) {
+    wave_stats_t stats;
+    wave_get_stats(&stats);
+
+    uart_writeText(name);
+    uart_writeText(": ");
+    uart_writeUInt(stats.steps);
+    uart_writeText(" steps in ");
+    uart_writeUInt(stats.interrupts);
+    uart_writeText(" interrupts, late avg ");
+    uart_writeUInt(stats.steps ? stats.late_total / stats.steps : 0);
+    uart_writeText(" us, max ");
+    uart_writeUInt(stats.late_max);
+    uart_writeText(" us\n");
+}
+
+/**
+ * Waveform engine: two servo pulses (1.5 ms and 1 ms, rising together) at 50 Hz, then a burst
+ * of edges closer together than a compare can be re-armed.
+ */
+static void bench_wave() {
+    static wave_edge_t burst[WAVE_BURST_EDGES];
+    wave_edge_t servo[] = {
+        { 0, WAVE_SERVO_PIN_A, 1 },
+        { 0, WAVE_SERVO_PIN_B, 1 },
+        { 1000, WAVE_SERVO_PIN_B, 0 },
+        { 1500, WAVE_SERVO_PIN_A, 0 },
+    };
+
+    wave_reset_stats();
+    if (!wave_start(servo, sizeof(servo) / sizeof(servo[0]), WAVE_SERVO_PERIOD)) {
+        uart_writeText("wave: compare 3 busy\n");
+        return;
+    }
+    timer_wait((WAVE_SERVO_FRAMES * WAVE_SERVO_PERIOD) / 1000);
+    wave_stop();
+    bench_wave_report("wave servo");
+
+    for (uint32_t i = 0; i < WAVE_BURST_EDGES; i++) {
+        burst[i].time_us = i * WAVE_BURST_STEP_US;
+        burst[i].pin = WAVE_BURST_PIN;
+        burst[i].level = !(i & 1);
+    }
+
+    wave_reset_stats();
+    wave_start(burst, WAVE_BURST_EDGES, 0);
+    while (wave_busy()) {
+        cpu_idle();
+    }
+    bench_wave_report("wave burst");
+}
+
+/**
+ * GPIO capture: core 3 polls the servo pins while the waveform engine drives them, and this
+ * core drains the ring and measures pin A's pulse width from the records.
+ */
+static void bench_capture() {
+    static capture_record_t records[CAPTURE_BENCH_BATCH];
+    wave_edge_t servo[] = {
+        { 0, WAVE_SERVO_PIN_A, 1 },
+        { 1500, WAVE_SERVO_PIN_A, 0 },
+    };
+    uint64_t pin_a = 1ULL << WAVE_SERVO_PIN_A;
+    uint64_t rise = 0;
+    uint64_t high_total = 0;
+    uint32_t pulses = 0;
+
+    if (!capture_start(CAPTURE_BENCH_CPU, pin_a | (1ULL << WAVE_SERVO_PIN_B), 0)) {
+        uart_writeText("capture: unavailable\n");
+        return;
+    }
+    if (!wave_start(servo, sizeof(servo) / sizeof(servo[0]), WAVE_SERVO_PERIOD)) {
+        uart_writeText("capture: compare 3 busy\n");
+    } else {
+        timer_wait((WAVE_SERVO_FRAMES * WAVE_SERVO_PERIOD) / 1000);
+        wave_stop();
+    }
+    capture_stop();
+
+    uint32_t count;
+    do {
+        count = capture_read(records, CAPTURE_BENCH_BATCH);
+        for (uint32_t i = 0; i < count; i++) {
+            if (records[i].levels & pin_a) {
+                rise = records[i].ticks;
+            } else if (rise) {
+                high_total += records[i].ticks - rise;
+                pulses++;
+                rise = 0;
+            }
+        }
+    } while (count || capture_active());
+
+    capture_dump();
+    uart_writeText("capture: ");
+    uart_writeUInt(pulses);
+    uart_writeText(" pulses on pin A, avg width ");
+    uart_writeUInt(pulses ? clock_ticks_to_ns(high_total / pulses) / 1000 : 0);
+    uart_writeText(" us\n");
+}
+
+/**
+ * Runs every benchmark and prints the results over UART.
+ */
+void bench_run() {
+    uart_writeText("---- Benchmarks ----\n");
+    bench_cache();
+    bench_memzero();
+    bench_string();
+    page_alloc_dump();
+    bench_kmem();
+    if (BENCH_GIC) {
+        bench_irq_entry();
+        bench_fiq_entry();
+        bench_irq_nesting();
+        bench_irq_nesting_uart();
+        bench_softirq();
+        bench_ipi();
+        bench_irq_affinity();
+    }
+    bench_crit();
+    bench_clocksource();
+    bench_timer();
+    bench_local_timer();
+    bench_idle();
+    bench_wave();
+    bench_capture();
+    latency_run();
+    irq_stats_dump();
+}
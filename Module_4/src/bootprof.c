@@ -0,0 +1,54 @@
+#include <bootprof.h>
+#include <timer.h>
+#include <uart.h>
+
+typedef struct {
+    char *phase;
+    uint64_t ticks;
+} bootprof_entry;
+
+static bootprof_entry bootprof_table[BOOTPROF_MAX_PHASES];
+static uint32_t bootprof_count;
+
+/**
+ * Starts the table with the counter value boot.S captured on entry to _start.
+ */
+void bootprof_init(uint64_t start_ticks) {
+    bootprof_table[0].phase = "_start";
+    bootprof_table[0].ticks = start_ticks;
+    bootprof_count = 1;
+}
+
+/**
+ * Records the end of a boot phase. Extra marks past the table size are dropped.
+ */
+void bootprof_mark(char *phase) {
+    if (bootprof_count >= BOOTPROF_MAX_PHASES) {
+        return;
+    }
+
+    bootprof_table[bootprof_count].phase = phase;
+    bootprof_table[bootprof_count].ticks = get_cntpct();
+    bootprof_count++;
+}
+
+/**
+ * Prints every phase as "phase: +delta us (total us)" over UART. The UART must be initialized.
+ */
+void bootprof_dump() {
+    uint64_t freq = get_cntfrq();
+    uint64_t start = bootprof_table[0].ticks;
+
+    uart_writeText("---- Boot Profile ----\n");
+    for (uint32_t i = 1; i < bootprof_count; i++) {
+        uint64_t delta = bootprof_table[i].ticks - bootprof_table[i - 1].ticks;
+        uint64_t total = bootprof_table[i].ticks - start;
+
+        uart_writeText(bootprof_table[i].phase);
+        uart_writeText(": +");
+        uart_writeUInt((delta * 1000000) / freq);
+        uart_writeText(" us (");
+        uart_writeUInt((total * 1000000) / freq);
+        uart_writeText(" us)\n");
+    }
+}
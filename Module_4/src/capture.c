@@ -0,0 +1,266 @@
+#include <capture.h>
+#include <gpio.h>
+#include <ipi.h>
+#include <irq.h>
+#include <smp.h>
+#include <softirq.h>
+#include <timer.h>
+#include <clocksource.h>
+#include <idle.h>
+#include <uart.h>
+
+#define CAPTURE_STREAM_BATCH    64
+#define CAPTURE_STREAM_IDLE_US  100     // Consumer sleep when the ring is empty
+
+static capture_record_t capture_ring[CAPTURE_RING_SIZE];
+static volatile uint32_t capture_head;  // Written by the capture core only (stlr)
+static volatile uint32_t capture_tail;  // Written by the consumer only (stlr)
+
+static volatile uint32_t capture_running;       // Set by capture_start(), cleared by capture_poll() on exit (stlr)
+static volatile uint32_t capture_stopping;      // Set by capture_stop()
+static uint64_t capture_mask;
+static capture_stats_t capture_stats;
+
+#ifndef NO_GIC
+static uint64_t capture_duration;      // CNTPCT ticks, 0 = until capture_stop()
+
+/**
+ * Capture loop, run as deferred work on the capture core. IRQs stay masked so nothing on this
+ * core preempts a poll; capture_stop() and the duration end it. A change is only stored once
+ * there is room, so after an overflow the next record still has the current levels. The running
+ * flag is only released once the last record and the stats are written.
+ */
+static void capture_poll(void *arg) {
+    uint64_t flags = irq_save();
+    uint64_t prev = ~0ULL;
+    uint64_t start = get_cntpct();
+    uint64_t now = start;
+    uint32_t head = capture_head;
+
+    capture_stats.start = start;
+    while (!capture_stopping && (capture_duration == 0 || now - start < capture_duration)) {
+        uint64_t levels = (mmio_read(GPLEV0) | ((uint64_t)mmio_read(GPLEV1) << 32)) & capture_mask;
+
+        now = get_cntpct();
+        capture_stats.polls++;
+        if (levels == prev) {
+            continue;
+        }
+
+        uint32_t fill = head - capture_tail;
+        if (fill >= CAPTURE_RING_SIZE) {
+            capture_stats.dropped++;
+            continue;
+        }
+
+        capture_record_t *record = &capture_ring[head & (CAPTURE_RING_SIZE - 1)];
+        record->ticks = now;
+        record->levels = levels;
+        head++;
+        asm volatile("stlr %w0, [%1]" :: "r"(head), "r"(&capture_head) : "memory");
+
+        prev = levels;
+        capture_stats.records++;
+        if (fill + 1 > capture_stats.max_fill) {
+            capture_stats.max_fill = fill + 1;
+        }
+    }
+
+    capture_stats.end = now;
+    irq_isolate(0);
+    asm volatile("stlr wzr, [%0]" :: "r"(&capture_running) : "memory");
+    irq_restore(flags);
+}
+
+/**
+ * IPI_CAPTURE handler: starts the loop on this core once the IPI has been handled.
+ */
+static void capture_ipi(void *ctx) {
+    softirq_raise(capture_poll, NULL);
+}
+#endif
+
+/**
+ * Starts capturing the pins in pin_mask (bit n = GPIO n) on `cpu`, which must be an online
+ * secondary core other than the caller's. Core 0 is refused: it owns the UART, the compare 1
+ * timer wheel and every unpinned SPI, and can't be isolated. The capture core does nothing else
+ * until the capture ends, and SPIs are routed away from it meanwhile (irq_isolate()). Pin
+ * functions are left as they are, so outputs and peripheral pins can be watched too. Runs for
+ * duration_us, or until capture_stop() if 0. Returns 1 on success, 0 if a capture is running,
+ * the core can't be used, or there are no IPIs to start it (NO_GIC).
+ */
+uint32_t capture_start(uint32_t cpu, uint64_t pin_mask, uint32_t duration_us) {
+#ifdef NO_GIC
+    return 0;
+#else
+    static uint32_t capture_ipi_registered;
+
+    if (capture_running || cpu == 0 || cpu >= NUM_CORES || cpu == smp_cpu_id() || !percpu_data[cpu].online ||
+        (pin_mask & CAPTURE_PINS_MASK) == 0) {
+        return 0;
+    }
+
+    if (!capture_ipi_registered) {
+        if (!ipi_register(IPI_CAPTURE, capture_ipi, NULL)) {
+            return 0;
+        }
+        capture_ipi_registered = 1;
+    }
+
+    capture_mask = pin_mask & CAPTURE_PINS_MASK;
+    capture_duration = clock_ns_to_ticks((uint64_t)duration_us * 1000);
+    capture_head = 0;
+    capture_tail = 0;
+    capture_stats.polls = 0;
+    capture_stats.records = 0;
+    capture_stats.dropped = 0;
+    capture_stats.start = 0;
+    capture_stats.end = 0;
+    capture_stats.max_fill = 0;
+    capture_stopping = 0;
+    capture_running = 1;
+
+    // Nothing should wait on a core that polls with IRQs masked
+    irq_isolate(1 << cpu);
+
+    // ipi_send() orders the writes above before the capture core sees the IPI
+    ipi_send(1 << cpu, IPI_CAPTURE);
+    return 1;
+#endif
+}
+
+/**
+ * Asks the capture core to leave its loop. capture_active() turns 0 once it has.
+ */
+void capture_stop() {
+    capture_stopping = 1;
+}
+
+/**
+ * Returns non-zero until the capture core has left its loop. Once it returns 0 every record is
+ * in the ring and the stats are final.
+ */
+uint32_t capture_active() {
+    uint32_t running;
+    asm volatile("ldar %w0, [%1]" : "=r"(running) : "r"(&capture_running) : "memory");
+    return running;
+}
+
+/**
+ * Takes up to `max` records from the ring, oldest first. Returns how many were copied.
+ * Single consumer: only one core may read at a time.
+ */
+uint32_t capture_read(capture_record_t *records, uint32_t max) {
+    uint32_t head;
+    uint32_t tail = capture_tail;
+    uint32_t count = 0;
+
+    asm volatile("ldar %w0, [%1]" : "=r"(head) : "r"(&capture_head) : "memory");
+    while (tail != head && count < max) {
+        records[count++] = capture_ring[tail & (CAPTURE_RING_SIZE - 1)];
+        tail++;
+    }
+
+    // The slots are free for the producer only after they have been copied
+    asm volatile("stlr %w0, [%1]" :: "r"(tail), "r"(&capture_tail) : "memory");
+    return count;
+}
+
+/**
+ * Writes the low `bytes` bytes of value, little-endian. Waits for room in the UART queue rather
+ * than overwriting it, since one lost byte would break every frame after it.
+ */
+static void capture_put(uint64_t value, uint32_t bytes) {
+    for (uint32_t i = 0; i < bytes; i++) {
+        uart_writeByteWait(value >> (i * 8));
+    }
+}
+
+/**
+ * Packs the captured pins' levels into consecutive bits, lowest GPIO first.
+ */
+static uint64_t capture_pack(uint64_t levels) {
+    uint64_t packed = 0;
+    uint32_t out = 0;
+
+    for (uint64_t mask = capture_mask; mask; mask &= mask - 1) {
+        uint64_t pin = mask & -mask;
+        packed |= (uint64_t)((levels & pin) != 0) << out++;
+    }
+    return packed;
+}
+
+/**
+ * Streams the running capture over UART in the binary format in capture.h until it has ended and
+ * the ring is empty. Each record takes 5 bytes plus one byte per 8 captured pins.
+ */
+void capture_stream() {
+    static capture_record_t batch[CAPTURE_STREAM_BATCH];
+    uint32_t level_bytes = (__builtin_popcountll(capture_mask) + 7) / 8;
+    uint64_t last = get_cntpct();
+
+    capture_put(CAPTURE_MAGIC, 4);
+    capture_put(CAPTURE_VERSION, 1);
+    capture_put(clocksource.freq, 4);
+    capture_put(capture_mask, 8);
+    capture_put(last, 8);
+
+    while (1) {
+        // Read the flag first: a record stored before the loop ended is then still read below
+        uint32_t running = capture_active();
+        uint32_t count = capture_read(batch, CAPTURE_STREAM_BATCH);
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t delta = batch[i].ticks - last;
+
+            if (delta > 0xFFFFFFFF) {
+                capture_put(CAPTURE_FRAME_TIME, 1);
+                capture_put(batch[i].ticks, 8);
+                delta = 0;
+            }
+
+            capture_put(CAPTURE_FRAME_RECORD, 1);
+            capture_put(delta, 4);
+            capture_put(capture_pack(batch[i].levels), level_bytes);
+            last = batch[i].ticks;
+        }
+
+        if (count == 0) {
+            if (!running) {
+                break;
+            }
+            sleep_us(CAPTURE_STREAM_IDLE_US);
+        }
+    }
+
+    capture_put(CAPTURE_FRAME_END, 1);
+    capture_put(capture_stats.polls, 8);
+    capture_put(capture_stats.records, 8);
+    capture_put(capture_stats.dropped, 8);
+}
+
+void capture_get_stats(capture_stats_t *stats) {
+    *stats = capture_stats;
+}
+
+/**
+ * Prints the sustained poll rate and the record and drop counters. The elapsed time is only
+ * final once capture_active() has returned 0.
+ */
+void capture_dump() {
+    uint64_t ns = clock_ticks_to_ns(capture_stats.end - capture_stats.start);
+
+    uart_writeText("capture: ");
+    uart_writeUInt(capture_stats.polls);
+    uart_writeText(" polls in ");
+    uart_writeUInt(ns / 1000);
+    uart_writeText(" us (");
+    uart_writeUInt(ns ? (capture_stats.polls * 1000) / (ns / 1000000 ? ns / 1000000 : 1) : 0);
+    uart_writeText(" samples/s), ");
+    uart_writeUInt(capture_stats.records);
+    uart_writeText(" records, ");
+    uart_writeUInt(capture_stats.dropped);
+    uart_writeText(" dropped, max fill ");
+    uart_writeUInt(capture_stats.max_fill);
+    uart_writeText("\n");
+}
@@ -0,0 +1,47 @@
+#include <clocksource.h>
+#include <pmu.h>
+#include <uart.h>
+
+clocksource_t clocksource;
+
+/**
+ * Picks the counter and derives the conversion factors, then measures the PMU cycle rate over
+ * CLOCK_CALIBRATE_MS. Called once on the main core after pmu_init(), before the secondaries start.
+ */
+void clocksource_init() {
+    clocksource.freq = get_cntfrq();
+    clocksource.source = clock_src_cntpct;
+    if (clocksource.freq == 0) {
+        clocksource.source = clock_src_bcm;
+        clocksource.freq = CLOCK_HZ;
+    }
+
+    clocksource.mult = (CLOCK_NS_PER_SEC << CLOCK_SHIFT) / clocksource.freq;
+    clocksource.ns_mult = (clocksource.freq << CLOCK_SHIFT) / CLOCK_NS_PER_SEC;
+
+    uint64_t ticks = (clocksource.freq * CLOCK_CALIBRATE_MS) / 1000;
+    uint64_t start = clock_read();
+    uint64_t cycles = pmu_cycles();
+    uint64_t now;
+
+    while ((now = clock_read()) - start < ticks) {
+        // Spin
+    }
+    cycles = pmu_cycles() - cycles;
+
+    clocksource.cpu_hz = (cycles * clocksource.freq) / (now - start);
+    clocksource.cycle_mult = (CLOCK_NS_PER_SEC << CLOCK_SHIFT) / clocksource.cpu_hz;
+}
+
+/**
+ * Prints the active source and the calibrated CPU clock.
+ */
+void clocksource_dump() {
+    uart_writeText("clocksource: ");
+    uart_writeText(clocksource.source == clock_src_cntpct ? "CNTPCT" : "BCM System Timer");
+    uart_writeText(" at ");
+    uart_writeUInt(clocksource.freq);
+    uart_writeText(" Hz, CPU ");
+    uart_writeUInt(clocksource.cpu_hz / 1000);
+    uart_writeText(" kHz\n");
+}
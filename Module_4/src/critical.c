@@ -0,0 +1,97 @@
+#include <critical.h>
+#include <gic.h>
+#include <irq.h>
+#include <gpio.h>
+#include <pmu.h>
+#include <uart.h>
+
+/**
+ * Raises this core's priority mask to the section's level (never lowers it, so sections nest)
+ * and returns the state crit_exit() needs to restore it.
+ */
+crit_state_t crit_enter(crit_section_t *cs) {
+    crit_state_t state;
+
+#ifdef NO_GIC
+    // The ARMC has no priority mask: fall back to masking every IRQ, saving DAIF in prev_pmr
+    state.prev_pmr = irq_save();
+#else
+    state.prev_pmr = mmio_read(GICC_PMR);
+    if (cs->priority < state.prev_pmr) {
+        mmio_write(GICC_PMR, cs->priority);
+
+        // Read back so the CPU interface has applied the mask before the protected code runs
+        mmio_read(GICC_PMR);
+        asm volatile("isb" ::: "memory");
+    }
+#endif
+
+    this_cpu()->crit_depth++;
+    state.start = pmu_cycles();
+    return state;
+}
+
+/**
+ * Restores the priority mask saved by crit_enter() and records how long the section was held.
+ */
+void crit_exit(crit_section_t *cs, crit_state_t state) {
+    uint64_t cycles = pmu_cycles() - state.start;
+    crit_stats_t *stats = &cs->stats[smp_cpu_id()];
+
+    stats->count++;
+    stats->cycles_total += cycles;
+    if (cycles > stats->cycles_max) {
+        stats->cycles_max = cycles;
+    }
+
+    this_cpu()->crit_depth--;
+#ifdef NO_GIC
+    irq_restore(state.prev_pmr);
+#else
+    if (cs->priority < state.prev_pmr) {
+        asm volatile("dsb sy" ::: "memory");
+        mmio_write(GICC_PMR, state.prev_pmr);
+    }
+#endif
+}
+
+/**
+ * Returns non-zero while this core is inside a critical section.
+ */
+uint32_t crit_active() {
+    return this_cpu()->crit_depth != 0;
+}
+
+/**
+ * Sums a section's hold-time counters over all cores.
+ */
+void crit_get_stats(crit_section_t *cs, crit_stats_t *stats) {
+    stats->count = 0;
+    stats->cycles_total = 0;
+    stats->cycles_max = 0;
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        stats->count += cs->stats[cpu].count;
+        stats->cycles_total += cs->stats[cpu].cycles_total;
+        if (cs->stats[cpu].cycles_max > stats->cycles_max) {
+            stats->cycles_max = cs->stats[cpu].cycles_max;
+        }
+    }
+}
+
+/**
+ * Prints a section's hold-time counters.
+ */
+void crit_dump(crit_section_t *cs) {
+    crit_stats_t stats;
+    crit_get_stats(cs, &stats);
+
+    uart_writeText(cs->name);
+    uart_writeText(": held ");
+    uart_writeUInt(stats.count);
+    uart_writeText(" times, avg ");
+    uart_writeUInt(stats.count ? stats.cycles_total / stats.count : 0);
+    uart_writeText(" cycles, max ");
+    uart_writeUInt(stats.cycles_max);
+    uart_writeText(" cycles\n");
+}
@@ -4,14 +4,17 @@
 #include <font.h>
 #include <common.h>
 #include <uart.h>
+#include <mmu.h>
+#include <sysreg.h>
 
 unsigned int width, height, fb_pitch, isrgb, fb_size;
 unsigned char *fb_addr;
 
 /**
  * Initializes the Framebuffer using the Mailbox Property Channel.
+ * Returns 1 once the GPU has answered with a framebuffer address.
  */
-void fb_init() {
+unsigned int fb_init() {
     // Requesting mailbox to process multiple commands
     mbox[0] = 35 * 4; // length of message in bytes
     mbox[1] = MBOX_REQUEST; 
@@ -68,10 +71,16 @@ void fb_init() {
             width = mbox[5];
             height = mbox[6];
             isrgb = mbox[24];
+
+            // Scanout reads memory directly, so keep framebuffer writes out of the data cache
+            mmu_set_region((uintptr_t)fb_addr, fb_size, MT_NORMAL_NC);
+            return 1;
         }
     } else {
         //uart_writeText("Frame Buffer Init Failed\n");
     }
+
+    return 0;
 }
 
 /**
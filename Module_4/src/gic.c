@@ -5,6 +5,10 @@
 #define ENABLE_GRP  0x03
 #define P_MASK      0xFF
 #define DISABLE     0x00
+#define ALL_GROUP1  0xFFFFFFFF
+
+// The single interrupt routed as Group 0 / FIQ (GIC_SPURIOUS_IRQ when there is none)
+static uint32_t gic_fiq_irq = GIC_SPURIOUS_IRQ;
 
 /**
  * Enable the Distributer Controller. 
@@ -32,6 +36,11 @@ void gic_cpu_init() {
 
     // Set Binary Point for no priority grouping.
     mmio_write(GICC_BPR, DISABLE);
+
+    // SGIs are always enabled and their priorities are banked, so every core sets its own
+    for (uint32_t sgi = 0; sgi < GIC_NUM_SGIS; sgi++) {
+        set_irq_priority(sgi, GIC_SGI_PRIORITY);
+    }
 }
 
 /**
@@ -47,6 +56,28 @@ void enable_interrupt(uint32_t irq) {
     mmio_write(enableReg, (1 << offset));
 }
 
+/**
+ *  Stop the distributor from forwarding the given interrupt.
+ */
+void disable_interrupt(uint32_t irq) {
+    uint32_t n = irq / 32;
+    uint32_t offset = irq % 32;
+    long disableReg = GICD_CLR_ENABLER + (4 * n);
+
+    mmio_write(disableReg, (1 << offset));
+}
+
+/**
+ *  Mark the given interrupt pending in the distributor, as if its source had fired.
+ */
+void set_pending(uint32_t irq) {
+    uint32_t n = irq / 32;
+    uint32_t offset = irq % 32;
+    long pendingReg = GICD_SET_PENDING + (4 * n);
+
+    mmio_write(pendingReg, (1 << offset));
+}
+
 /**
  * Setting the priority value for the given IRQ number in the distributor.
  */
@@ -63,32 +94,48 @@ void set_irq_priority(uint32_t irq, uint32_t priority) {
 }   
 
 /**
- * Assign processor destination of interrupt (TEMP: Single-Core only routes to Core 0)
- * 
+ * Route an interrupt to the cores in cpu_mask (bit n = core n) through GICD_ITARGETSR.
+ *
  * NOTE:
- * - In a uniprocessor implementation, all interrupts target the one processor, and 
- *      the GICD_ITARGETSRs are RAZ/WI (Read as Zero/ Write Ignored)
+ * - SGI and PPI target bytes are read-only (they always target the core that reads them)
  */
-void assign_target(uint32_t irq) {
+void gic_set_target(uint32_t irq, uint32_t cpu_mask) {
     uint32_t reg_num = irq / 4; // Tells us which Target Register #
     uint32_t target = GICD_TARGET + (4 * reg_num);
 
     uint32_t offset = irq % 4; // Which byte in that register
     uint32_t bit_shift = offset * 8;
 
-    uint32_t val = (mmio_read(target) & ~(0xFF << bit_shift)) | (1 << bit_shift);
-
-    // Setting target to Core 0
+    uint32_t val = (mmio_read(target) & ~(0xFF << bit_shift)) | ((cpu_mask & 0xFF) << bit_shift);
     mmio_write(target, val);
 }
 
+/**
+ * Read back the cores an interrupt is routed to.
+ */
+uint32_t gic_get_target(uint32_t irq) {
+    uint32_t target = GICD_TARGET + (4 * (irq / 4));
+    return (mmio_read(target) >> ((irq % 4) * 8)) & 0xFF;
+}
+
+/**
+ * Assign the default destination of an interrupt: Core 0. irq_set_affinity() moves it later.
+ */
+void assign_target(uint32_t irq) {
+    gic_set_target(irq, 1 << 0);
+}
+
+/**
+ * Sets an interrupt's trigger in GICD_ICFGR (two bits per ID; the upper one selects edge).
+ * SGI and PPI configurations are fixed on the GIC-400, so writes for them are ignored.
+ */
 void set_configuration(uint32_t irq, gicd_cfg_flags_t flag) {
     uint32_t reg_num = irq / 16;
     uint32_t bit_pos = (irq % 16) * 2;
     uint32_t cfg_addr = GICD_ICFGR + (4 * reg_num);
     uint32_t val;
     if (flag == level_sensitive) {
-        val = mmio_read(cfg_addr) & ~(1 << bit_pos);
+        val = mmio_read(cfg_addr) & ~(edge_triggered << bit_pos);
     } else {
         val = mmio_read(cfg_addr) | (flag << bit_pos);
     }
@@ -104,26 +151,78 @@ void clear_interrupt(uint32_t irq) {
 }
 
 /**
- * Function to setup a singular interrupt
+ * Function to setup a singular interrupt. Drivers go through irq_register(), which
+ * installs the handler before calling this.
  */
 void setup_interrupt(uint32_t irq, uint32_t priority, gicd_cfg_flags_t flag) {
-    enable_interrupt(irq);
+    // Configure the line fully before it can be forwarded
     set_irq_priority(irq, priority);
     assign_target(irq);
     set_configuration(irq, flag);
+    enable_interrupt(irq);
+}
+
+/**
+ * Raises SGI `sgi` on every core in cpu_mask (bit n = core n).
+ */
+void gic_send_sgi(uint32_t cpu_mask, uint32_t sgi) {
+    // Make earlier writes visible to the targets before they take the interrupt
+    asm volatile("dsb ishst" ::: "memory");
+    mmio_write(GICD_SGIR, ((cpu_mask & 0xFF) << 16) | (sgi & 0xF));
 }
 
 /**
- * Initialization of the GIC-400
+ * Routes one interrupt to the FIQ exception as Group 0 and moves every other line to Group 1 (IRQ).
+ * Returns 1 on success. Returns 0 if an FIQ source is already set, or if the core runs Non-secure:
+ * the group registers are then RAZ/WI and Group 0 is reserved for the Secure firmware.
+ */
+uint32_t gic_set_fiq(uint32_t irq, uint32_t priority, gicd_cfg_flags_t flag) {
+    if (irq >= GIC_NUM_IRQS || gic_fiq_irq != GIC_SPURIOUS_IRQ) {
+        return 0;
+    }
+
+    for (uint32_t n = 0; n < GIC_NUM_IRQS / 32; n++) {
+        mmio_write(GICD_IGROUPR + (4 * n), ALL_GROUP1);
+    }
+    if (mmio_read(GICD_IGROUPR + 4) == 0) {
+        return 0;
+    }
+
+    // IAR keeps acknowledging the Group 1 lines for the IRQ path; Group 0 now raises FIQ
+    mmio_write(GICC_CTLR, mmio_read(GICC_CTLR) | GICC_CTLR_ACKCTL | GICC_CTLR_FIQEN);
+
+    long groupReg = GICD_IGROUPR + (4 * (irq / 32));
+    mmio_write(groupReg, mmio_read(groupReg) & ~(1 << (irq % 32)));
+
+    gic_fiq_irq = irq;
+    setup_interrupt(irq, priority, flag);
+    return 1;
+}
+
+/**
+ * Disables the FIQ source and returns it to Group 1.
+ */
+void gic_clear_fiq() {
+    uint32_t irq = gic_fiq_irq;
+
+    if (irq == GIC_SPURIOUS_IRQ) {
+        return;
+    }
+
+    disable_interrupt(irq);
+
+    long groupReg = GICD_IGROUPR + (4 * (irq / 32));
+    mmio_write(groupReg, mmio_read(groupReg) | (1 << (irq % 32)));
+    mmio_write(GICC_CTLR, mmio_read(GICC_CTLR) & ~GICC_CTLR_FIQEN);
+
+    gic_fiq_irq = GIC_SPURIOUS_IRQ;
+}
+
+/**
+ * Initialization of the GIC-400. Individual lines are enabled by their drivers through irq_register().
  */
 void gic_init() {
     gic_dist_init();
     
     gic_cpu_init();
-
-    // Enable Timer Interrupts
-    setup_interrupt(SYS_TIMER_IRQ_1, 0xA0, edge_triggered);
-
-    // Enable UART Interrupts
-    setup_interrupt(PL011_UART_IRQ, 0x90, level_sensitive);
 }   
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <idle.h>
+#include <irq.h>
+#include <smp.h>
+#include <softirq.h>
+#include <local_timer.h>
+#include <clocksource.h>
+#include <uart.h>
+
+// CNTPCT at the last idle_reset(): the start of the residency window
+static uint64_t idle_since;
+
+/**
+ * Waits in wfi and counts the time as idle. Called with IRQs masked: a pending interrupt still
+ * ends the wait, but its handler only runs once the caller unmasks, so it isn't counted as idle.
+ */
+static void idle_wfi() {
+    uint64_t start = get_cntpct();
+
+    asm volatile("dsb sy\n\twfi" ::: "memory");
+    this_cpu()->idle_ticks += get_cntpct() - start;
+}
+
+/**
+ * One pass of the idle loop: sleeps until the next interrupt unless deferred work is queued.
+ * The check and the wfi run with IRQs masked, so work raised in between still wakes the core.
+ */
+void cpu_idle() {
+    uint64_t flags = irq_save();
+
+    if (!softirq_pending()) {
+        idle_wfi();
+    }
+
+    // The interrupt that ended the wait is taken here
+    irq_restore(flags);
+}
+
+/**
+ * Sleeps until now_ns() reaches deadline_ns, in wfi with this core's CNTP set to wake it.
+ * Spins instead where the CNTP interrupt could be held off for the whole wait (in an IRQ handler
+ * or a critical section), or when there is no CNTP to wake it (NO_GIC, the BCM clocksource fallback,
+ * or before local_timer_init()).
+ */
+void sleep_until(uint64_t deadline_ns) {
+    uint64_t deadline = clock_ns_to_ticks(deadline_ns);
+    uint32_t can_sleep = clocksource.source == clock_src_cntpct &&
+                         this_cpu()->irq_depth == 0 && this_cpu()->crit_depth == 0;
+
+    while (clock_read() < deadline) {
+        if (!can_sleep) {
+            continue;
+        }
+
+        uint64_t flags = irq_save();
+        if (local_timer_wake_at(deadline) && clock_read() < deadline) {
+            idle_wfi();
+        }
+        irq_restore(flags);
+    }
+}
+
+void sleep_us(uint64_t us) {
+    sleep_until(now_ns() + us * 1000);
+}
+
+/**
+ * Share of the time since idle_reset() that a core spent in wfi, in hundredths of a percent.
+ */
+uint32_t idle_residency(uint32_t cpu) {
+    uint64_t window = get_cntpct() - idle_since;
+
+    if (cpu >= NUM_CORES || window == 0) {
+        return 0;
+    }
+
+    return (percpu_data[cpu].idle_ticks * 10000) / window;
+}
+
+/**
+ * Starts a new residency window on every core.
+ */
+void idle_reset() {
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        percpu_data[cpu].idle_ticks = 0;
+    }
+    idle_since = get_cntpct();
+}
+
+/**
+ * Prints each online core's idle residency, which is also its load: 100% minus idle.
+ */
+void idle_dump() {
+    uart_writeText("---- Idle Residency ----\n");
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        if (!percpu_data[cpu].online) {
+            continue;
+        }
+
+        uint32_t idle = idle_residency(cpu);
+
+        uart_writeText("cpu ");
+        uart_writeInt(cpu);
+        uart_writeText(": idle ");
+        uart_writeUInt(idle / 100);
+        uart_writeText(".");
+        uart_writeUInt((idle % 100) / 10);
+        uart_writeUInt(idle % 10);
+        uart_writeText("%\n");
+    }
+}
@@ -0,0 +1,58 @@
+#include <ipi.h>
+#include <gic.h>
+#include <smp.h>
+
+/**
+ * IPI_WAKEUP: nothing to do, the interrupt itself is the wakeup.
+ */
+static void ipi_wakeup_handler(void *ctx) {
+    // Taking the interrupt is enough to leave wfi/wfe
+}
+
+/**
+ * IPI_TLB_FLUSH: drops this core's EL1 TLB entries after the sender changed the tables.
+ */
+static void ipi_tlb_flush_handler(void *ctx) {
+    asm volatile("dsb ishst\n\ttlbi vmalle1\n\tdsb nsh\n\tisb" ::: "memory");
+}
+
+/**
+ * Installs the built-in IPI handlers. Called once on the main core after gic_init().
+ */
+void ipi_init() {
+    ipi_register(IPI_WAKEUP, ipi_wakeup_handler, NULL);
+    ipi_register(IPI_TLB_FLUSH, ipi_tlb_flush_handler, NULL);
+}
+
+/**
+ * Installs the handler every core runs when it receives an IPI of this type.
+ * Returns 1 on success, 0 if the type is out of range or already taken.
+ */
+uint32_t ipi_register(uint32_t type, irq_handler_t handler, void *ctx) {
+    if (type >= IPI_NUM_TYPES) {
+        return 0;
+    }
+
+    return irq_register(type, handler, ctx, GIC_SGI_PRIORITY, edge_triggered);
+}
+
+void ipi_unregister(uint32_t type) {
+    if (type < IPI_NUM_TYPES) {
+        irq_unregister(type);
+    }
+}
+
+/**
+ * Sends an IPI to every core in cpu_mask (bit n = core n). The sender's earlier writes are
+ * visible to the handler.
+ */
+void ipi_send(uint32_t cpu_mask, uint32_t type) {
+    gic_send_sgi(cpu_mask & IPI_ALL_CPUS, type);
+}
+
+/**
+ * Sends an IPI to every core except the caller.
+ */
+void ipi_send_others(uint32_t type) {
+    ipi_send(IPI_ALL_CPUS & ~(1 << smp_cpu_id()), type);
+}
@@ -3,10 +3,113 @@
 #include <gpio.h>
 #include <timer.h>
 #include <uart.h>
+#include <pmu.h>
+#include <smp.h>
+#include <softirq.h>
 
 #define ENABLE 1
 #define DISABLE 0
 
+// Flat handler table indexed by GIC interrupt ID for O(1) dispatch (ARMC sources use the same IDs)
+static irq_desc_t irq_table[GIC_NUM_IRQS];
+
+// Counters are per core so the dispatch path never shares a line with another core
+static irq_stats_t irq_stats[NUM_CORES][GIC_NUM_IRQS];
+static uint64_t irq_unhandled[NUM_CORES];
+static uint64_t irq_drain_hist[NUM_CORES][IRQ_DRAIN_BUCKETS];
+static uint64_t irq_nested_cycles[NUM_CORES];      // Cycles spent in handlers, used to exclude preemption
+static uint64_t irq_off_max[NUM_CORES];            // Longest span from IRQ entry to the end of the drain
+
+// The FIQ source has its own slot so handle_fiq_el1h never looks at irq_table
+static irq_desc_t fiq_desc;
+static uint32_t fiq_irq = GIC_SPURIOUS_IRQ;
+
+#ifdef BENCH
+// IRQ-off tracing: the open span per core and nesting depth (0 = thread), and the longest seen
+static uint64_t irq_off_start[NUM_CORES][IRQ_MAX_NESTING + 1];
+static uintptr_t irq_off_site[NUM_CORES][IRQ_MAX_NESTING + 1];
+static irq_off_span_t irq_off_top[NUM_CORES][IRQ_OFF_TOP];
+#endif
+
+// Affinity: pinned lines are left alone by the balancer
+static uint8_t irq_pinned[GIC_NUM_IRQS];
+#ifndef NO_GIC
+static volatile uint32_t irq_isolated;             // Cores that take no SPIs (irq_isolate())
+static uint64_t irq_balance_last[GIC_NUM_IRQS];    // Handler cycles at the previous irq_balance()
+#endif
+static volatile uint32_t irq_balancing;
+static timer_handle_t irq_balance_timer;
+
+// Deepest handler nesting allowed on a core (1 = handlers always run with IRQs masked)
+static uint32_t irq_max_nesting = IRQ_MAX_NESTING;
+
+#ifdef BENCH
+/**
+ * Opens an IRQ-off span on this core at the current nesting depth.
+ */
+static void irq_off_begin(uintptr_t site) {
+    uint32_t cpu = smp_cpu_id();
+    uint32_t depth = this_cpu()->irq_depth;
+
+    if (depth <= IRQ_MAX_NESTING) {
+        irq_off_site[cpu][depth] = site;
+        irq_off_start[cpu][depth] = pmu_cycles();
+    }
+}
+
+/**
+ * Closes the open span, if any, and keeps it if it is among this core's IRQ_OFF_TOP longest.
+ */
+static void irq_off_end() {
+    uint32_t cpu = smp_cpu_id();
+    uint32_t depth = this_cpu()->irq_depth;
+
+    if (depth > IRQ_MAX_NESTING || irq_off_start[cpu][depth] == 0) {
+        return;
+    }
+
+    uint64_t cycles = pmu_cycles() - irq_off_start[cpu][depth];
+    irq_off_start[cpu][depth] = 0;
+
+    irq_off_span_t *shortest = &irq_off_top[cpu][0];
+    for (uint32_t i = 1; i < IRQ_OFF_TOP; i++) {
+        if (irq_off_top[cpu][i].cycles < shortest->cycles) {
+            shortest = &irq_off_top[cpu][i];
+        }
+    }
+
+    if (cycles > shortest->cycles) {
+        shortest->cycles = cycles;
+        shortest->site = irq_off_site[cpu][depth];
+    }
+}
+#endif
+
+/**
+ * Masks IRQs on this core. BENCH builds record the span until the matching irq_enable(),
+ * tagged with the caller's address.
+ */
+void irq_disable() {
+    uint64_t daif;
+    asm volatile("mrs %0, DAIF\n\tmsr DAIFSet, #2" : "=r"(daif) :: "memory");
+
+#ifdef BENCH
+    if (!(daif & DAIF_IRQ)) {
+        irq_off_begin((uintptr_t)__builtin_return_address(0));
+    }
+#endif
+}
+
+/**
+ * Unmasks IRQs on this core.
+ */
+void irq_enable() {
+#ifdef BENCH
+    irq_off_end();
+#endif
+    asm volatile("msr DAIFClr, #2" ::: "memory");
+}
+
 /**
  * Reports which interrupt is set and the exception information on the invalid entry.
  */
@@ -28,31 +131,621 @@ void exception_report(uint64_t type, uint64_t esr, uint64_t elr ,uint64_t spsr)
 }
 
 /**
- * Interrupt Controller that controls the behavior of each interrupt source.
+ * Installs a handler for a GIC interrupt ID and enables the line with the given priority and trigger.
+ * SGIs are always enabled with the per-core priority set in gic_cpu_init(), so only the handler is set.
+ * With NO_GIC the source is enabled in the ARMC instead, and priority and trigger are ignored.
+ * Returns 1 on success, 0 if the ID is out of range, already has a handler, or has no ARMC line.
  */
-void irq_el1h_handler() {
-    uint32_t irq_ack = mmio_read(GICC_IAR);
-    uint32_t irq_num = irq_ack & 0x3FF; // first 10 bits
+uint32_t irq_register(uint32_t irq, irq_handler_t handler, void *ctx, uint32_t priority, gicd_cfg_flags_t trigger) {
+    if (irq >= GIC_NUM_IRQS || handler == NULL || irq_table[irq].handler != NULL) {
+        return 0;
+    }
 
-    // SYSTEM TIMER 1                                                                                                                             
-    switch (irq_num) {
-        case SYS_TIMER_IRQ_1: {
-            handle_timer1(); // Timer 1 Interrupt
-            break;
+    // The descriptor must be in place before the distributor can forward the line
+    irq_table[irq].ctx = ctx;
+    irq_table[irq].handler = handler;
+    asm volatile("dsb ish" ::: "memory");
+
+    if (irq >= GIC_NUM_SGIS) {
+#ifdef NO_GIC
+        // The ARMC has no priorities and its VideoCore sources are level: only the route is set
+        if (!armc_enable_interrupt(irq)) {
+            irq_table[irq].handler = NULL;
+            irq_table[irq].ctx = NULL;
+            return 0;
+        }
+#else
+        setup_interrupt(irq, priority, trigger);
+#endif
+    }
+    return 1;
+}
+
+/**
+ * Disables the line in the distributor and removes its handler.
+ */
+void irq_unregister(uint32_t irq) {
+    if (irq >= GIC_NUM_IRQS) {
+        return;
+    }
+
+    if (irq >= GIC_NUM_SGIS) {
+#ifdef NO_GIC
+        armc_disable_interrupt(irq);
+#else
+        disable_interrupt(irq);
+#endif
+    }
+    irq_table[irq].handler = NULL;
+    irq_table[irq].ctx = NULL;
+}
+
+/**
+ * Sets how many IRQ handlers may be active on a core at once. A handler only unmasks IRQs
+ * while the depth is below this, so 1 restores fully masked, non-preemptive handling.
+ */
+void irq_set_max_nesting(uint32_t depth) {
+    irq_max_nesting = (depth == 0) ? 1 : depth;
+}
+
+/**
+ * Routes a shared peripheral interrupt to the cores in cpu_mask (bit n = core n) and pins it
+ * there, so the balancer won't move it. Isolated cores are left out of the mask. Returns 1 on
+ * success, 0 for SGIs/PPIs (banked per core), a mask with no online, non-isolated core, or NO_GIC.
+ */
+uint32_t irq_set_affinity(uint32_t irq, uint32_t cpu_mask) {
+#ifdef NO_GIC
+    // Sources are only routed to core 0's ARMC IRQ
+    return 0;
+#else
+    uint32_t allowed = smp_online_mask() & ~irq_isolated;
+
+    if (irq < GIC_FIRST_SPI || irq >= GIC_NUM_IRQS || (cpu_mask & allowed) == 0) {
+        return 0;
+    }
+
+    irq_pinned[irq] = 1;
+    gic_set_target(irq, cpu_mask & allowed);
+    return 1;
+#endif
+}
+
+/**
+ * Keeps the SPIs off the cores in cpu_mask, for a core that runs with IRQs masked for a long time
+ * (capture_start()). Lines routed there, pinned ones included, move to their other cores or to
+ * core 0, and irq_set_affinity() and irq_balance() leave those cores out until irq_isolate(0).
+ * Core 0 is never isolated.
+ */
+void irq_isolate(uint32_t cpu_mask) {
+#ifdef NO_GIC
+    // Sources are only routed to core 0's ARMC IRQ
+#else
+    irq_isolated = cpu_mask & ~1u;
+    asm volatile("dmb ish" ::: "memory");
+
+    for (uint32_t irq = GIC_FIRST_SPI; irq < GIC_NUM_IRQS; irq++) {
+        uint32_t target = gic_get_target(irq);
+
+        if (target & irq_isolated) {
+            target &= ~irq_isolated;
+            gic_set_target(irq, target ? target : 1);
+        }
+    }
+#endif
+}
+
+/**
+ * Reads back the cores an interrupt is routed to from the distributor.
+ */
+uint32_t irq_get_affinity(uint32_t irq) {
+    if (irq >= GIC_NUM_IRQS) {
+        return 0;
+    }
+
+#ifdef NO_GIC
+    return 1;
+#else
+    return gic_get_target(irq);
+#endif
+}
+
+/**
+ * Hands a pinned interrupt back to the balancer.
+ */
+void irq_unpin(uint32_t irq) {
+    if (irq < GIC_NUM_IRQS) {
+        irq_pinned[irq] = 0;
+    }
+}
+
+/**
+ * Spreads the unpinned SPIs over the online cores by the handler time each used since the
+ * previous call: busiest line first, each to the core with the least load so far. A line stays
+ * where it is when its core is tied for least loaded. Returns how many lines were moved.
+ */
+uint32_t irq_balance() {
+#ifdef NO_GIC
+    return 0;
+#else
+    uint32_t online = smp_online_mask() & ~irq_isolated;
+    uint64_t cpu_load[NUM_CORES] = { 0 };
+    uint64_t load[GIC_NUM_IRQS];
+    uint32_t moved = 0;
+
+    for (uint32_t irq = GIC_FIRST_SPI; irq < GIC_NUM_IRQS; irq++) {
+        irq_stats_t stats;
+
+        load[irq] = 0;
+        if (irq_table[irq].handler == NULL || irq == fiq_irq) {
+            continue;
+        }
+
+        irq_get_stats(irq, &stats);
+        load[irq] = stats.cycles_total - irq_balance_last[irq];
+        irq_balance_last[irq] = stats.cycles_total;
+
+        if (irq_pinned[irq]) {
+            // Pinned load still counts against the cores it runs on
+            uint32_t target = gic_get_target(irq);
+            for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+                if (target == (1u << cpu)) {
+                    cpu_load[cpu] += load[irq];
+                }
+            }
+            load[irq] = 0;
         }
-        case PL011_UART_IRQ: {
-            // OR of all UART IRQ asserts
-            uart_handler();
+    }
+
+    while (1) {
+        uint32_t busiest = GIC_SPURIOUS_IRQ;
+        uint64_t busiest_load = 0;
+        for (uint32_t irq = GIC_FIRST_SPI; irq < GIC_NUM_IRQS; irq++) {
+            if (load[irq] > busiest_load) {
+                busiest = irq;
+                busiest_load = load[irq];
+            }
+        }
+        if (busiest == GIC_SPURIOUS_IRQ) {
             break;
         }
-        case 1023: // Spurious
-            return;
-        default:
-            // uart_writeText("ERROR: Unknown Interrupt ID");
-            // uart_writeInt(irq_num);
-            // uart_writeText("\n");
+
+        uint32_t target = gic_get_target(busiest);
+        uint32_t best = NUM_CORES;
+        for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+            if (!(online & (1 << cpu))) {
+                continue;
+            }
+            if (best == NUM_CORES || cpu_load[cpu] < cpu_load[best] ||
+                (cpu_load[cpu] == cpu_load[best] && target == (1u << cpu))) {
+                best = cpu;
+            }
+        }
+
+        cpu_load[best] += load[busiest];
+        load[busiest] = 0;
+
+        if (target != (1u << best)) {
+            gic_set_target(busiest, 1 << best);
+            moved++;
+        }
+    }
+
+    return moved;
+#endif
+}
+
+/**
+ * Deferred rebalance, queued by irq_balance_timeout().
+ */
+static void irq_balance_work(void *arg) {
+    irq_balance();
+}
+
+/**
+ * Balancer timer: defers the rebalance to softirq context and re-arms while balancing is on.
+ */
+static void irq_balance_timeout(void *ctx) {
+    if (irq_balancing) {
+        softirq_raise(irq_balance_work, NULL);
+        irq_balance_timer = timer_add(get_timer64() + IRQ_BALANCE_PERIOD_US, irq_balance_timeout, NULL);
+    }
+}
+
+/**
+ * Turns the periodic balancer on or off. While on, a rebalance is queued every IRQ_BALANCE_PERIOD_US.
+ */
+void irq_set_balancing(uint32_t enabled) {
+    irq_balancing = enabled;
+
+    timer_cancel(irq_balance_timer);
+    irq_balance_timer = enabled ? timer_add(get_timer64() + IRQ_BALANCE_PERIOD_US, irq_balance_timeout, NULL) : 0;
+}
+
+/**
+ * Sums the counters for one interrupt ID over all cores.
+ */
+void irq_get_stats(uint32_t irq, irq_stats_t *stats) {
+    stats->count = 0;
+    stats->cycles_total = 0;
+    stats->cycles_max = 0;
+
+    if (irq >= GIC_NUM_IRQS) {
+        return;
+    }
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        irq_stats_t *s = &irq_stats[cpu][irq];
+
+        stats->count += s->count;
+        stats->cycles_total += s->cycles_total;
+        if (s->cycles_max > stats->cycles_max) {
+            stats->cycles_max = s->cycles_max;
+        }
+    }
+}
+
+/**
+ * Returns how many interrupts were acknowledged with no handler registered.
+ */
+uint64_t irq_unhandled_count() {
+    uint64_t count = 0;
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        count += irq_unhandled[cpu];
+    }
+
+    return count;
+}
+
+/**
+ * Returns the longest time, over all cores, spent draining the GIC in one IRQ entry. For that
+ * span the running priority (or PSTATE.I) blocks every interrupt at or below the one being handled.
+ */
+uint64_t irq_max_off_cycles() {
+    uint64_t max = 0;
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        if (irq_off_max[cpu] > max) {
+            max = irq_off_max[cpu];
+        }
+    }
+
+    return max;
+}
+
+void irq_reset_max_off() {
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        irq_off_max[cpu] = 0;
+    }
+}
+
+/**
+ * Prints the longest IRQ-off spans recorded at irq_disable()/irq_enable() and at IRQ entry/exit,
+ * longest first, with the code address that masked IRQs.
+ */
+void irq_off_report() {
+#ifdef BENCH
+    irq_off_span_t spans[NUM_CORES * IRQ_OFF_TOP];
+    uint32_t cpus[NUM_CORES * IRQ_OFF_TOP];
+    uint32_t n = 0;
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        for (uint32_t i = 0; i < IRQ_OFF_TOP; i++) {
+            if (irq_off_top[cpu][i].cycles) {
+                spans[n] = irq_off_top[cpu][i];
+                cpus[n++] = cpu;
+            }
+        }
+    }
+
+    uart_writeText("---- Longest IRQ-off spans ----\n");
+    for (uint32_t i = 0; i < n && i < IRQ_OFF_TOP; i++) {
+        uint32_t longest = i;
+        for (uint32_t j = i + 1; j < n; j++) {
+            if (spans[j].cycles > spans[longest].cycles) {
+                longest = j;
+            }
+        }
+
+        irq_off_span_t span = spans[longest];
+        uint32_t cpu = cpus[longest];
+        spans[longest] = spans[i];
+        cpus[longest] = cpus[i];
+
+        uart_writeUInt(span.cycles);
+        uart_writeText(" cycles, cpu ");
+        uart_writeInt(cpu);
+        if (span.site == (uintptr_t)irq_el1h_handler) {
+            uart_writeText(", irq entry\n");
+        } else {
+            uart_writeText(", masked at ");
+            uart_writeHex(span.site);
+            uart_writeText("\n");
+        }
+    }
+#endif
+    uart_writeText("max hard-IRQ span: ");
+    uart_writeUInt(irq_max_off_cycles());
+    uart_writeText(" cycles\n");
+}
+
+/**
+ * Clears the IRQ-off records.
+ */
+void irq_off_reset() {
+#ifdef BENCH
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        for (uint32_t i = 0; i < IRQ_OFF_TOP; i++) {
+            irq_off_top[cpu][i].cycles = 0;
+        }
+    }
+#endif
+    irq_reset_max_off();
+}
+
+/**
+ * Sums the drain histogram over all cores. hist[n] counts exception entries that handled
+ * n interrupts (0 = spurious entry); the last bucket collects everything above.
+ */
+void irq_get_drain_hist(uint64_t hist[IRQ_DRAIN_BUCKETS]) {
+    for (uint32_t i = 0; i < IRQ_DRAIN_BUCKETS; i++) {
+        hist[i] = 0;
+        for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+            hist[i] += irq_drain_hist[cpu][i];
+        }
+    }
+}
+
+/**
+ * Prints the counters of every interrupt that has fired.
+ */
+void irq_stats_dump() {
+    uart_writeText("---- IRQ Stats ----\n");
+
+    for (uint32_t irq = 0; irq < GIC_NUM_IRQS; irq++) {
+        irq_stats_t stats;
+
+        irq_get_stats(irq, &stats);
+        if (stats.count == 0) {
+            continue;
+        }
+
+        uart_writeText("IRQ ");
+        uart_writeInt(irq);
+        uart_writeText(": count ");
+        uart_writeUInt(stats.count);
+        uart_writeText(", avg ");
+        uart_writeUInt(stats.cycles_total / stats.count);
+        uart_writeText(" cycles, max ");
+        uart_writeUInt(stats.cycles_max);
+        uart_writeText(" cycles, cpus ");
+        uart_writeHex(irq_get_affinity(irq));
+        uart_writeText("\n");
+    }
+
+    uart_writeText("unhandled: ");
+    uart_writeUInt(irq_unhandled_count());
+    uart_writeText("\n");
+
+    uint64_t hist[IRQ_DRAIN_BUCKETS];
+    irq_get_drain_hist(hist);
+
+    uart_writeText("max IRQ-off: ");
+    uart_writeUInt(irq_max_off_cycles());
+    uart_writeText(" cycles\n");
+
+    uart_writeText("IRQs drained per entry:\n");
+    for (uint32_t i = 0; i < IRQ_DRAIN_BUCKETS; i++) {
+        if (hist[i] == 0) {
+            continue;
+        }
+
+        uart_writeText("  ");
+        uart_writeInt(i);
+        uart_writeText(i == IRQ_DRAIN_BUCKETS - 1 ? "+: " : ": ");
+        uart_writeUInt(hist[i]);
+        uart_writeText("\n");
+    }
+}
+
+/**
+ * Runs the registered handler for an acknowledged interrupt and updates this core's counters.
+ * Called with IRQs masked. Below the nesting limit the handler runs with IRQs unmasked: the
+ * GIC's running priority is now this interrupt's, so only higher priority interrupts preempt it.
+ */
+static void irq_dispatch(uint32_t irq_num, uint32_t allow_nest) {
+    uint32_t cpu = smp_cpu_id();
+    irq_desc_t *desc = &irq_table[irq_num];
+
+    if (desc->handler == NULL) {
+        irq_unhandled[cpu]++;
+        return;
+    }
+
+    uint32_t nest = allow_nest && this_cpu()->irq_depth < irq_max_nesting;
+    uint64_t nested_before = irq_nested_cycles[cpu];
+    uint64_t start = pmu_cycles();
+
+    if (nest) {
+        irq_enable();
+    }
+    desc->handler(desc->ctx);
+    if (nest) {
+        irq_disable();
+    }
+
+    // Don't charge this handler for the handlers that preempted it. Each handler adds only its own
+    // exclusive time, so the sum over everything nested inside this one is exactly its inclusive time.
+    uint64_t total = pmu_cycles() - start;
+    uint64_t cycles = total - (irq_nested_cycles[cpu] - nested_before);
+    irq_nested_cycles[cpu] += cycles;
+
+    irq_stats_t *stats = &irq_stats[cpu][irq_num];
+    stats->count++;
+    stats->cycles_total += cycles;
+    if (cycles > stats->cycles_max) {
+        stats->cycles_max = cycles;
+    }
+}
+
+#ifdef NO_GIC
+/**
+ * Drains the ARMC: snapshots the pending bitmaps and services every set bit, lowest ID first,
+ * before reading them again. Handlers run with IRQs masked, since the ARMC has no running
+ * priority and a level source stays asserted until its handler clears it. Returns the count.
+ */
+static uint32_t irq_drain() {
+    uint32_t pending[ARMC_NUM_BANKS];
+    uint32_t drained = 0;
+
+    while (armc_read_pending(pending)) {
+        for (uint32_t bank = 0; bank < ARMC_NUM_BANKS; bank++) {
+            uint32_t bits = pending[bank];
+
+            while (bits) {
+                uint32_t irq_num = armc_bank_irq(bank) + armc_lowest_bit(bits);
+                bits &= bits - 1;
+
+                // Nothing would ever clear a source without a handler, so stop it re-asserting
+                if (irq_table[irq_num].handler == NULL) {
+                    armc_disable_interrupt(irq_num);
+                }
+
+                irq_dispatch(irq_num, 0);
+                drained++;
+            }
+        }
+    }
+
+    return drained;
+}
+#else
+/**
+ * Drains the GIC: acknowledges and dispatches pending interrupts until GICC_IAR reads spurious.
+ * Returns the count.
+ */
+static uint32_t irq_drain() {
+    uint32_t cpu = smp_cpu_id();
+    uint32_t drained = 0;
+
+    while (1) {
+        uint32_t irq_ack = mmio_read(GICC_IAR);
+        uint32_t irq_num = irq_ack & GICC_IAR_ID_MASK;
+
+        if (irq_num == GIC_SPURIOUS_IRQ) {
             break;
+        }
+
+        if (irq_num < GIC_NUM_IRQS) {
+            irq_dispatch(irq_num, 1);
+        } else {
+            irq_unhandled[cpu]++;
+        }
+
+        clear_interrupt(irq_ack);
+        drained++;
+    }
+
+    return drained;
+}
+#endif
+
+/**
+ * Services every pending interrupt in one exception entry, so a burst costs one entry/exit
+ * instead of one per interrupt.
+ */
+void irq_el1h_handler() {
+    uint32_t cpu = smp_cpu_id();
+    uint64_t start = pmu_cycles();
+
+#ifdef BENCH
+    // IRQs have been masked since the exception was taken
+    irq_off_begin((uintptr_t)irq_el1h_handler);
+#endif
+
+    uint32_t drained = irq_drain();
+
+    irq_drain_hist[cpu][drained < IRQ_DRAIN_BUCKETS ? drained : IRQ_DRAIN_BUCKETS - 1]++;
+
+    uint64_t off = pmu_cycles() - start;
+    if (off > irq_off_max[cpu]) {
+        irq_off_max[cpu] = off;
+    }
+
+    // Deferred work runs once the outermost handler is done, with IRQs enabled again. Not when
+    // this IRQ preempted a critical section: the work may need what that section holds.
+    if (this_cpu()->irq_depth == 1 && this_cpu()->crit_depth == 0 && softirq_pending()) {
+        irq_enable();
+        softirq_run();
+        irq_disable();
+    }
+
+#ifdef BENCH
+    // The eret unmasks IRQs again
+    irq_off_end();
+#endif
+}
+
+/**
+ * Makes an interrupt the FIQ source: Group 0 in the GIC, serviced by handle_fiq_el1h on its own
+ * stack with IRQs masked. The handler must not take locks or allocate, since it can preempt
+ * any IRQ handler or spin_lock_irqsave() section. Returns 1 on success, 0 if the ID is taken,
+ * another FIQ source is set, or the GIC's Group 0 is unavailable (Non-secure boot, or NO_GIC).
+ */
+uint32_t fiq_register(uint32_t irq, irq_handler_t handler, void *ctx, uint32_t priority, gicd_cfg_flags_t trigger) {
+#ifdef NO_GIC
+    return 0;
+#else
+    if (irq >= GIC_NUM_IRQS || handler == NULL || irq_table[irq].handler != NULL || fiq_desc.handler != NULL) {
+        return 0;
+    }
+
+    // Also install it in irq_table, for the rare case the IRQ path acknowledges it first
+    fiq_desc.ctx = ctx;
+    fiq_desc.handler = handler;
+    irq_table[irq] = fiq_desc;
+    fiq_irq = irq;
+    asm volatile("dsb ish" ::: "memory");
+
+    if (!gic_set_fiq(irq, priority, trigger)) {
+        fiq_unregister();
+        return 0;
+    }
+
+    return 1;
+#endif
+}
+
+/**
+ * Disables the FIQ source and hands the line back to Group 1.
+ */
+void fiq_unregister() {
+    gic_clear_fiq();
+
+    if (fiq_irq < GIC_NUM_IRQS) {
+        irq_table[fiq_irq].handler = NULL;
+        irq_table[fiq_irq].ctx = NULL;
+    }
+    fiq_desc.handler = NULL;
+    fiq_desc.ctx = NULL;
+    fiq_irq = GIC_SPURIOUS_IRQ;
+}
+
+/**
+ * FIQ dispatcher: calls the FIQ handler directly. With GICC_CTLR.AckCtl set, IAR can return a
+ * higher priority Group 1 interrupt instead, which is dispatched through irq_table without nesting.
+ */
+void fiq_el1h_handler() {
+    uint32_t irq_ack = mmio_read(GICC_IAR);
+    uint32_t irq_num = irq_ack & GICC_IAR_ID_MASK;
+
+    if (irq_num == fiq_irq) {
+        fiq_desc.handler(fiq_desc.ctx);
+    } else if (irq_num < GIC_NUM_IRQS) {
+        irq_dispatch(irq_num, 0);
+    } else {
+        return;     // Spurious
     }
 
     clear_interrupt(irq_ack);
-}
\ No newline at end of file
+}
@@ -3,18 +3,20 @@
 #include <uart.h>
 #include <irq.h>
 #include <gic.h>
+#include <ipi.h>
 #include <timer.h>
+#include <local_timer.h>
+#include <pmu.h>
+#include <clocksource.h>
+#include <bench.h>
+#include <smp.h>
+#include <bootprof.h>
+#include <page_alloc.h>
+#include <kmem.h>
+#include <softirq.h>
+#include <idle.h>
 #include <common.h>
 
-static void __attribute__((noinline)) reset() {
-    // Zero the .bss section
-    extern unsigned int __bss_start, __bss_end;
-
-    for(unsigned int* i = &__bss_start; i < &__bss_end; i++) {
-        *i = 0;
-    }
-}
-
 // First, figure out where you are
 uint32_t get_el() {
     uint32_t el;
@@ -30,37 +32,87 @@ uint32_t get_daif() {
 }
 
 void main() {
-    reset();
+    // BSS is already zeroed by boot.S
+    bootprof_mark("mmu + bss");
+    pmu_init();
+    clocksource_init();
     led_init();
     
-    // GIC Initialization
+    // Interrupt Controller Initialization
     led_on();
+#ifdef NO_GIC
+    armc_init();
+#else
     gic_init();
-    delay(1000);
+    ipi_init();
+#endif
     led_off();
+    bootprof_mark("gic");
 
     // Timer Initialization
     timer_init();
+    local_timer_init();
+    bootprof_mark("timer");
 
-    // UART 0 Initialization
+    // UART 0 Initialization (ready as soon as UARTEN is set)
     led_on();
     uart_init();
-    timer_wait(500);
+    bootprof_mark("uart");
 
     uart_writeText("PL011 UART 0 Initialized\n");
-    
-    timer_wait(1000);
     led_off();
 
-    // Frame Buffer Initialization
+    // Page Allocator (sized by the mailbox GET_ARM_MEMORY property)
+    page_alloc_init();
+    kmem_init();
+    bootprof_mark("page_alloc + kmem");
+
+    // Frame Buffer Initialization (mbox_call waits for the GPU's response)
     led_on();
-    fb_init();
-    timer_wait(1000);
-    uart_writeText("Frame Buffer Initialized\n");
+    if (fb_init()) {
+        uart_writeText("Frame Buffer Initialized\n");
+    } else {
+        uart_writeText("Frame Buffer Init Failed\n");
+    }
     led_off();
+    bootprof_mark("fb");
+
+    // Release the secondary cores
+    smp_init();
+    bootprof_mark("smp");
+    uart_writeText("Cores online: ");
+    uart_writeInt(smp_num_online());
+    uart_writeText("\n");
+
+    bootprof_dump();
+
+#ifdef BENCH
+    bench_run();
+#endif
     
-    timer_wait(1000);
+    idle_reset();
     while(1) {
+        // Idle: pick up deferred work queued from thread context, then sleep until an interrupt
+        softirq_run();
+        cpu_idle();
+    }
+}
 
+/**
+ * Per-core entry point for cores 1-3 (the main core runs main()).
+ */
+void secondary_main() {
+    pmu_init();
+
+#ifndef NO_GIC
+    // The GIC CPU interface is banked, so every core enables its own
+    gic_cpu_init();
+#endif
+    local_timer_init();
+
+    this_cpu()->online = 1;
+    while(1) {
+        softirq_run();
+        cpu_idle();
     }
-}
\ No newline at end of file
+}
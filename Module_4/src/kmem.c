@@ -0,0 +1,233 @@
+#include <kmem.h>
+#include <smp.h>
+#include <uart.h>
+
+// Objects cached on one core for one context. Only that core, at that IRQ nesting
+// level, ever touches it, so the fast paths need no atomics and no IRQ masking.
+typedef struct {
+    uint32_t count;
+    void *objs[KMEM_MAG_SIZE];
+    uint64_t allocs;
+    uint64_t frees;
+} __attribute__((aligned(CACHE_LINE_SIZE))) kmem_magazine;
+
+extern char __kmem_arena_start[], __kmem_arena_end[];
+
+static kmem_cache_t kmem_caches[KMEM_NUM_CLASSES];
+static kmem_magazine magazines[NUM_CORES][KMEM_CONTEXTS][KMEM_NUM_CLASSES];
+
+static uint8_t slab_class[KMEM_MAX_SLABS];      // Size class that owns each arena slab
+static uint32_t arena_slabs;
+static uint32_t arena_next;
+static spinlock_t arena_lock = SPINLOCK_INIT;
+
+/**
+ * Sets up the size classes over the link.ld arena.
+ */
+void kmem_init() {
+    arena_slabs = (__kmem_arena_end - __kmem_arena_start) >> KMEM_SLAB_SHIFT;
+    if (arena_slabs > KMEM_MAX_SLABS) {
+        arena_slabs = KMEM_MAX_SLABS;
+    }
+
+    for (uint32_t i = 0; i < KMEM_NUM_CLASSES; i++) {
+        kmem_caches[i].obj_size = 1 << (KMEM_MIN_SHIFT + i);
+    }
+}
+
+/**
+ * Carves a new arena slab into objects on the cache's free list. Called with the cache lock held.
+ */
+static uint32_t kmem_grow(kmem_cache_t *cache) {
+    spin_lock(&arena_lock);
+    if (arena_next == arena_slabs) {
+        spin_unlock(&arena_lock);
+        return 0;
+    }
+    uint32_t slab = arena_next++;
+    slab_class[slab] = cache - kmem_caches;
+    spin_unlock(&arena_lock);
+
+    char *base = __kmem_arena_start + ((uintptr_t)slab << KMEM_SLAB_SHIFT);
+    for (uint32_t off = KMEM_SLAB_SIZE; off > 0; off -= cache->obj_size) {
+        void **obj = (void **)(base + off - cache->obj_size);
+        *obj = cache->free_list;
+        cache->free_list = obj;
+    }
+
+    cache->slabs++;
+    return 1;
+}
+
+/**
+ * Slow path: moves up to KMEM_BATCH objects from the cache into an empty magazine.
+ */
+static void kmem_refill(kmem_cache_t *cache, kmem_magazine *mag) {
+    uint64_t flags = spin_lock_irqsave(&cache->lock);
+
+    while (mag->count < KMEM_BATCH) {
+        if (cache->free_list == NULL && !kmem_grow(cache)) {
+            break;
+        }
+
+        void **obj = cache->free_list;
+        cache->free_list = *obj;
+        mag->objs[mag->count++] = obj;
+    }
+
+    cache->refills++;
+    spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+/**
+ * Slow path: returns the top KMEM_BATCH objects of a full magazine to the cache.
+ */
+static void kmem_flush(kmem_cache_t *cache, kmem_magazine *mag) {
+    uint64_t flags = spin_lock_irqsave(&cache->lock);
+
+    for (uint32_t i = 0; i < KMEM_BATCH; i++) {
+        void **obj = mag->objs[--mag->count];
+        *obj = cache->free_list;
+        cache->free_list = obj;
+    }
+
+    cache->flushes++;
+    spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+/**
+ * Returns this core's magazine for the cache in the current context, or NULL when
+ * nested deeper than KMEM_CONTEXTS (those go straight to the locked cache).
+ */
+static inline kmem_magazine *kmem_magazine_get(kmem_cache_t *cache) {
+    percpu_t *cpu = this_cpu();
+
+    if (cpu->irq_depth >= KMEM_CONTEXTS) {
+        return NULL;
+    }
+
+    return &magazines[cpu->cpu_id][cpu->irq_depth][cache - kmem_caches];
+}
+
+/**
+ * Allocates one object from the cache. Returns NULL once the arena is exhausted.
+ */
+void *kmem_cache_alloc(kmem_cache_t *cache) {
+    kmem_magazine *mag = kmem_magazine_get(cache);
+
+    if (mag == NULL) {
+        uint64_t flags = spin_lock_irqsave(&cache->lock);
+        void **obj = NULL;
+
+        if (cache->free_list != NULL || kmem_grow(cache)) {
+            obj = cache->free_list;
+            cache->free_list = *obj;
+        }
+
+        spin_unlock_irqrestore(&cache->lock, flags);
+        return obj;
+    }
+
+    if (mag->count == 0) {
+        kmem_refill(cache, mag);
+
+        if (mag->count == 0) {
+            return NULL;
+        }
+    }
+
+    mag->allocs++;
+    return mag->objs[--mag->count];
+}
+
+/**
+ * Returns one object to the cache it was allocated from.
+ */
+void kmem_cache_free(kmem_cache_t *cache, void *obj) {
+    kmem_magazine *mag = kmem_magazine_get(cache);
+
+    if (mag == NULL) {
+        uint64_t flags = spin_lock_irqsave(&cache->lock);
+        *(void **)obj = cache->free_list;
+        cache->free_list = obj;
+        spin_unlock_irqrestore(&cache->lock, flags);
+        return;
+    }
+
+    if (mag->count == KMEM_MAG_SIZE) {
+        kmem_flush(cache, mag);
+    }
+
+    mag->frees++;
+    mag->objs[mag->count++] = obj;
+}
+
+/**
+ * Returns the smallest size class that fits the given size, or NULL if it is over 2 KB.
+ */
+kmem_cache_t *kmem_size_cache(size_t size) {
+    for (uint32_t i = 0; i < KMEM_NUM_CLASSES; i++) {
+        if (size <= kmem_caches[i].obj_size) {
+            return &kmem_caches[i];
+        }
+    }
+
+    return NULL;
+}
+
+void *kmalloc(size_t size) {
+    kmem_cache_t *cache = kmem_size_cache(size);
+    return cache ? kmem_cache_alloc(cache) : NULL;
+}
+
+/**
+ * Frees an object from kmalloc(). The owning size class comes from its arena slab.
+ */
+void kfree(void *obj) {
+    if (obj == NULL || (char *)obj < __kmem_arena_start) {
+        return;
+    }
+
+    uint32_t slab = ((char *)obj - __kmem_arena_start) >> KMEM_SLAB_SHIFT;
+    if (slab >= arena_next) {
+        return;
+    }
+
+    kmem_cache_free(&kmem_caches[slab_class[slab]], obj);
+}
+
+/**
+ * Prints slab usage and magazine traffic per size class over UART.
+ */
+void kmem_dump() {
+    uart_writeText("---- Slab Allocator ----\n");
+    uart_writeText("arena slabs used: ");
+    uart_writeInt(arena_next);
+    uart_writeText("/");
+    uart_writeInt(arena_slabs);
+    uart_writeText("\n");
+
+    for (uint32_t i = 0; i < KMEM_NUM_CLASSES; i++) {
+        uint64_t allocs = 0, frees = 0;
+
+        for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+            for (uint32_t ctx = 0; ctx < KMEM_CONTEXTS; ctx++) {
+                allocs += magazines[cpu][ctx][i].allocs;
+                frees += magazines[cpu][ctx][i].frees;
+            }
+        }
+
+        uart_writeInt(kmem_caches[i].obj_size);
+        uart_writeText(" B: slabs ");
+        uart_writeUInt(kmem_caches[i].slabs);
+        uart_writeText(", allocs ");
+        uart_writeUInt(allocs);
+        uart_writeText(", frees ");
+        uart_writeUInt(frees);
+        uart_writeText(", refills ");
+        uart_writeUInt(kmem_caches[i].refills);
+        uart_writeText(", flushes ");
+        uart_writeUInt(kmem_caches[i].flushes);
+        uart_writeText("\n");
+    }
+}
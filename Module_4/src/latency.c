@@ -0,0 +1,188 @@
+#include <latency.h>
+#include <bench.h>
+#include <irq.h>
+#include <gic.h>
+#include <gpio.h>
+#include <timer.h>
+#include <uart.h>
+#include <string.h>
+#include <clocksource.h>
+
+#define LAT_TIMER_PRIO          0x90                    // Same level as the system tick
+#define LAT_FLOOD_PRIO          0xA0                    // The UART's level
+#define LAT_FLOOD_READS         16                      // Register reads per flood interrupt (a FIFO drain)
+#define LAT_BUSY_SIZE           (64 * 1024)
+
+static char *lat_load_names[lat_num_loads] = { "idle", "uart flood", "busy loop" };
+
+static lat_hist_t *lat_hist;
+static volatile uint32_t lat_done;
+static volatile uint32_t lat_flooding;
+
+// CNTPCT at the moment the System Timer read lat_base_clo, to convert compare values to CNTPCT
+static uint64_t lat_base_cnt;
+static uint32_t lat_base_clo;
+static uint32_t lat_target;
+static uint64_t lat_deadline;
+
+static uint8_t __attribute__((aligned(CACHE_LINE_SIZE))) lat_busy_src[LAT_BUSY_SIZE];
+static uint8_t __attribute__((aligned(CACHE_LINE_SIZE))) lat_busy_dst[LAT_BUSY_SIZE];
+
+/**
+ * Programs C3 for the System Timer tick lat_target and the matching CNTPCT deadline.
+ */
+static void lat_arm(uint32_t target) {
+    lat_target = target;
+    // Full-precision conversion: a whole ticks-per-us factor drifts (62.5 MHz would become 62)
+    lat_deadline = lat_base_cnt + clock_ns_to_ticks((uint64_t)(target - lat_base_clo) * 1000);
+    mmio_write(SYS_TIMER_C3, target);
+}
+
+static void lat_record(uint64_t ns) {
+    lat_hist->count++;
+    lat_hist->total_ns += ns;
+    if (ns < lat_hist->min_ns) {
+        lat_hist->min_ns = ns;
+    }
+    if (ns > lat_hist->max_ns) {
+        lat_hist->max_ns = ns;
+    }
+
+    uint64_t bucket = ns / LAT_BUCKET_NS;
+    lat_hist->hist[bucket < LAT_BUCKETS ? bucket : LAT_BUCKETS]++;
+}
+
+/**
+ * C3 compare handler: the first thing it does is read CNTPCT.
+ */
+static void lat_timer_handler(void *ctx) {
+    uint64_t now = get_cntpct();
+
+    mmio_write(SYS_TIMER_CS, 1 << 3);
+    lat_record(clock_ticks_to_ns(now - lat_deadline));
+
+    if (lat_hist->count >= LAT_SAMPLES) {
+        // The flood re-pends itself from IRQ context, so thread code would never get to stop it
+        lat_flooding = 0;
+        lat_done = 1;
+        return;
+    }
+
+    // Skip ahead if a long preemption made us miss the next deadline
+    uint32_t next = lat_target + LAT_PERIOD_US;
+    if ((int32_t)(next - get_timer32()) < 2) {
+        next = get_timer32() + LAT_PERIOD_US;
+    }
+    lat_arm(next);
+}
+
+/**
+ * Background UART-level interrupt: a burst of register reads, then pends itself again.
+ */
+static void lat_flood_handler(void *ctx) {
+    for (uint32_t i = 0; i < LAT_FLOOD_READS; i++) {
+        mmio_read(UART0_FR);
+    }
+
+    if (lat_flooding) {
+        set_pending(BENCH_IRQ_LAT_FLOOD);
+    }
+}
+
+/**
+ * Collects LAT_SAMPLES timer latencies on core 0 under the given background load.
+ */
+void latency_measure(lat_load_t load, lat_hist_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min_ns = ~0ULL;
+    lat_hist = hist;
+    lat_done = 0;
+
+    irq_register(SYS_TIMER_IRQ_3, lat_timer_handler, NULL, LAT_TIMER_PRIO, edge_triggered);
+    if (load == lat_load_uart_flood) {
+        irq_register(BENCH_IRQ_LAT_FLOOD, lat_flood_handler, NULL, LAT_FLOOD_PRIO, edge_triggered);
+        lat_flooding = 1;
+        set_pending(BENCH_IRQ_LAT_FLOOD);
+    }
+
+    // Line CNTPCT up with a System Timer tick edge
+    uint32_t clo = get_timer32();
+    while ((lat_base_clo = get_timer32()) == clo) {
+        // Wait for the next microsecond
+    }
+    lat_base_cnt = get_cntpct();
+    lat_arm(lat_base_clo + LAT_PERIOD_US);
+
+    while (!lat_done) {
+        if (load == lat_load_busy) {
+            memcpy(lat_busy_dst, lat_busy_src, LAT_BUSY_SIZE);
+        } else if (load == lat_load_idle) {
+            asm volatile("wfi");
+        }
+    }
+
+    lat_flooding = 0;
+    timer_wait(1);
+    irq_unregister(BENCH_IRQ_LAT_FLOOD);
+    irq_unregister(SYS_TIMER_IRQ_3);
+}
+
+/**
+ * Prints min/avg/p99/max and the non-empty histogram buckets.
+ */
+void latency_report(char *name, lat_hist_t *hist) {
+    uint64_t p99 = hist->max_ns;
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < LAT_BUCKETS; i++) {
+        seen += hist->hist[i];
+        if (seen * 100 >= hist->count * 99) {
+            p99 = (uint64_t)(i + 1) * LAT_BUCKET_NS;
+            break;
+        }
+    }
+
+    uart_writeText("irq latency (");
+    uart_writeText(name);
+    uart_writeText("): min ");
+    uart_writeUInt(hist->min_ns);
+    uart_writeText(", avg ");
+    uart_writeUInt(hist->count ? hist->total_ns / hist->count : 0);
+    uart_writeText(", p99 ");
+    uart_writeUInt(p99);
+    uart_writeText(", max ");
+    uart_writeUInt(hist->max_ns);
+    uart_writeText(" ns\n");
+
+    for (uint32_t i = 0; i <= LAT_BUCKETS; i++) {
+        if (hist->hist[i] == 0) {
+            continue;
+        }
+
+        uart_writeText("  ");
+        uart_writeUInt((uint64_t)i * LAT_BUCKET_NS);
+        uart_writeText(i == LAT_BUCKETS ? "+ ns: " : " ns: ");
+        uart_writeUInt(hist->hist[i]);
+        uart_writeText("\n");
+    }
+}
+
+/**
+ * Runs every background load and reports over UART, then the longest IRQ-off spans.
+ */
+void latency_run() {
+    static lat_hist_t hist;
+
+    irq_off_reset();
+    for (uint32_t load = 0; load < lat_num_loads; load++) {
+#ifdef NO_GIC
+        // The flood is pended by software through the GIC
+        if (load == lat_load_uart_flood) {
+            continue;
+        }
+#endif
+        latency_measure(load, &hist);
+        latency_report(lat_load_names[load], &hist);
+    }
+    irq_off_report();
+}
@@ -0,0 +1,178 @@
+#include <local_timer.h>
+#include <timer.h>
+#include <gic.h>
+#include <smp.h>
+#include <clocksource.h>
+
+static local_timer_t local_timers[NUM_CORES];
+
+/**
+ * Points CNTP_CVAL at the earlier of the user deadline and the sleep wakeup, or stops the timer.
+ * Called with IRQs masked on this core.
+ */
+static void local_timer_program(local_timer_t *lt) {
+    uint64_t cval = lt->armed ? lt->deadline : LOCAL_TIMER_NONE;
+
+    if (lt->wake < cval) {
+        cval = lt->wake;
+    }
+
+    if (cval == LOCAL_TIMER_NONE) {
+        cntp_write_ctl(0);
+    } else {
+        cntp_write_cval(cval);
+        cntp_write_ctl(CNTP_CTL_ENABLE);
+    }
+}
+
+#ifndef NO_GIC
+/**
+ * PPI 30 handler, run on the core whose timer fired. The line is level-sensitive, so it's deasserted
+ * (next deadline or disable) before the handler runs and the GIC sees the EOI.
+ */
+static void local_timer_irq(void *ctx) {
+    local_timer_t *lt = &local_timers[smp_cpu_id()];
+    uint64_t now = get_cntpct();
+    uint32_t fire = lt->armed && now >= lt->deadline;
+
+    if (now >= lt->wake) {
+        // The sleeper re-checks the time once this returns
+        lt->wake = LOCAL_TIMER_NONE;
+    }
+
+    if (fire) {
+        if (lt->period) {
+            // Step from the previous deadline, not from now, so the tick doesn't drift
+            lt->deadline += lt->period;
+        } else {
+            lt->armed = 0;
+        }
+        lt->fired++;
+    }
+    local_timer_program(lt);
+
+    if (fire && lt->handler) {
+        lt->handler(lt->ctx);
+    }
+}
+#endif
+
+/**
+ * Sets up the calling core's timer, stopped, and enables PPI 30 in its banked GIC registers.
+ * Called on every core after its GIC CPU interface is up. Returns 1 on success, 0 with NO_GIC
+ * (the ARMC doesn't see PPIs).
+ */
+uint32_t local_timer_init() {
+#ifdef NO_GIC
+    return 0;
+#else
+    local_timer_t *lt = &local_timers[smp_cpu_id()];
+
+    lt->wake = LOCAL_TIMER_NONE;
+    cntp_write_ctl(0);
+
+    // The first core installs the handler; PPI priority and enable are banked, so the others set their own
+    if (!irq_register(LOCAL_TIMER_IRQ, local_timer_irq, NULL, LOCAL_TIMER_PRIORITY, level_sensitive)) {
+        set_irq_priority(LOCAL_TIMER_IRQ, LOCAL_TIMER_PRIORITY);
+        enable_interrupt(LOCAL_TIMER_IRQ);
+    }
+
+    lt->ready = 1;
+    return 1;
+#endif
+}
+
+/**
+ * Sets what this core's timer calls when it fires (from IRQ context, on this core).
+ */
+void local_timer_set_handler(irq_handler_t handler, void *ctx) {
+    local_timer_t *lt = &local_timers[smp_cpu_id()];
+
+    lt->ctx = ctx;
+    lt->handler = handler;
+}
+
+/**
+ * Arms the user timer on this core: the first expiry at `deadline`, then every `period` ticks
+ * (0 = one-shot).
+ */
+static void local_timer_arm(uint64_t deadline, uint64_t period) {
+    local_timer_t *lt = &local_timers[smp_cpu_id()];
+    uint64_t flags = irq_save();
+
+    lt->period = period;
+    lt->deadline = deadline;
+    lt->armed = 1;
+    local_timer_program(lt);
+    irq_restore(flags);
+}
+
+/**
+ * One-shot at an absolute CNTPCT value. A deadline already passed fires right away.
+ */
+void local_timer_at(uint64_t deadline) {
+    local_timer_arm(deadline, 0);
+}
+
+/**
+ * One-shot `us` microseconds from now.
+ */
+void local_timer_after(uint32_t us) {
+    local_timer_arm(get_cntpct() + local_timer_us_to_ticks(us), 0);
+}
+
+/**
+ * Fires this core's timer every period_us until local_timer_stop().
+ */
+void local_timer_start_tick(uint32_t period_us) {
+    uint64_t period = local_timer_us_to_ticks(period_us);
+
+    local_timer_arm(get_cntpct() + period, period);
+}
+
+void local_timer_stop() {
+    local_timer_t *lt = &local_timers[smp_cpu_id()];
+    uint64_t flags = irq_save();
+
+    lt->armed = 0;
+    lt->period = 0;
+    local_timer_program(lt);
+    irq_restore(flags);
+}
+
+/**
+ * Wakes this core from wfi at `deadline` (CNTPCT) without disturbing the user timer. The wakeup
+ * is dropped once it has fired. Called with IRQs masked, between checking the time and wfi.
+ * Returns 1 if a wakeup is set, 0 if this core has no local timer.
+ */
+uint32_t local_timer_wake_at(uint64_t deadline) {
+    local_timer_t *lt = &local_timers[smp_cpu_id()];
+
+    if (!lt->ready) {
+        return 0;
+    }
+
+    if (deadline < lt->wake) {
+        lt->wake = deadline;
+        local_timer_program(lt);
+    }
+    return 1;
+}
+
+/**
+ * Returns how many times this core's timer has fired.
+ */
+uint64_t local_timer_fired() {
+    return local_timers[smp_cpu_id()].fired;
+}
+
+uint64_t local_timer_us_to_ticks(uint64_t us) {
+    return clock_ns_to_ticks(us * 1000);
+}
+
+/**
+ * Microseconds since the counter started, from CNTPCT_EL0: a system register read, no MMIO.
+ */
+uint64_t local_timer_now_us() {
+    return clock_ticks_to_ns(get_cntpct()) / 1000;
+}
@@ -1,6 +1,7 @@
 #include <mb.h>
 #include <uart.h>
 #include <gpio.h>
+#include <mmu.h>
 
 // The buffer must be 16-byte aligned as only the upper 28 bits of the address can be passed via the mailbox
 volatile unsigned int __attribute__((aligned(16))) mbox[36];
@@ -26,6 +27,9 @@ unsigned int mbox_call(unsigned char ch) {
         // uart_writeText("MBOX FULL\n");
     }
 
+    // Push the request out of the data cache so the VideoCore sees it
+    dcache_clean_inval((uintptr_t)mbox, sizeof(mbox));
+
     // Write the address to the mailbox
     mmio_write(MBOX_WRITE, r);
 
@@ -35,7 +39,11 @@ unsigned int mbox_call(unsigned char ch) {
             // Wait until the mailbox is not empty
         }
 
-        if (r == mmio_read(MBOX_READ)) return (mbox[1] == MBOX_RESPONSE);
+        if (r == mmio_read(MBOX_READ)) {
+            // Drop any lines fetched while the VideoCore was writing the response
+            dcache_clean_inval((uintptr_t)mbox, sizeof(mbox));
+            return (mbox[1] == MBOX_RESPONSE);
+        }
     }
     
     return 0; // Should never reach here
@@ -0,0 +1,89 @@
+#include <mmu.h>
+#include <sysreg.h>
+
+// Identity-mapped translation tables. They live outside the BSS range because the
+// BSS is zeroed after the MMU is on, so mmu_init() writes every entry itself.
+uint64_t __attribute__((aligned(PAGE_SIZE), section(".pgtables"))) mmu_l1_table[TABLE_ENTRIES];
+static uint64_t __attribute__((aligned(PAGE_SIZE), section(".pgtables"))) mmu_l2_tables[MMU_NUM_L2][TABLE_ENTRIES];
+
+/**
+ * Builds the block descriptor that identity maps the 2MB section at the given address.
+ */
+static uint64_t block_entry(uint64_t addr, uint32_t attr) {
+    uint64_t entry = addr | PD_BLOCK | PD_AF | PD_ATTR(attr);
+
+    if (attr == MT_DEVICE_nGnRnE || attr == MT_DEVICE_nGnRE) {
+        // Never execute or speculatively fetch from device memory
+        entry |= PD_PXN | PD_UXN;
+    } else {
+        entry |= PD_SH_INNER;
+    }
+
+    return entry;
+}
+
+/**
+ * Builds the identity map of the low 4GB. Runs on the main core before the MMU is on,
+ * so this file is compiled with -mstrict-align.
+ *  - RAM below DEVICE_BASE is Normal Write-Back cacheable
+ *  - The peripheral window and the GIC-400 are Device-nGnRE
+ */
+void mmu_init() {
+    for (uint64_t i = 0; i < TABLE_ENTRIES; i++) {
+        mmu_l1_table[i] = (i < MMU_NUM_L2) ? ((uint64_t)(uintptr_t)mmu_l2_tables[i] | PD_TABLE) : 0;
+    }
+
+    for (uint64_t i = 0; i < MMU_NUM_L2; i++) {
+        for (uint64_t j = 0; j < TABLE_ENTRIES; j++) {
+            uint64_t addr = (i << L1_SHIFT) | (j << SECTION_SHIFT);
+            mmu_l2_tables[i][j] = (addr < DEVICE_BASE) ? block_entry(addr, MT_NORMAL)
+                                                       : block_entry(addr, MT_DEVICE_nGnRE);
+        }
+    }
+
+    // Make the tables visible to the table walker before TTBR0 is loaded
+    asm volatile("dsb ish" ::: "memory");
+}
+
+/**
+ * Cleans and invalidates the data cache lines covering [start, start + size) to the point of coherency.
+ * Needed around buffers shared with the VideoCore (mailbox, framebuffer).
+ */
+void dcache_clean_inval(uintptr_t start, size_t size) {
+    uintptr_t end = start + size;
+
+    for (uintptr_t addr = start & ~(CACHE_LINE_SIZE - 1); addr < end; addr += CACHE_LINE_SIZE) {
+        asm volatile("dc civac, %0" :: "r"(addr) : "memory");
+    }
+    asm volatile("dsb sy" ::: "memory");
+}
+
+/**
+ * Changes the memory type of the 2MB sections covering [base, base + size) at runtime.
+ * Uses break-before-make so no core sees two conflicting translations for the same block.
+ */
+void mmu_set_region(uintptr_t base, size_t size, uint32_t attr) {
+    uintptr_t start = base & ~(uintptr_t)(SECTION_SIZE - 1);
+    uintptr_t end = base + size;
+
+    // Write back anything cached under the old attributes
+    dcache_clean_inval(base, size);
+
+    for (uintptr_t addr = start; addr < end; addr += SECTION_SIZE) {
+        uint32_t i = (addr >> L1_SHIFT) & (TABLE_ENTRIES - 1);
+        uint32_t j = (addr >> SECTION_SHIFT) & (TABLE_ENTRIES - 1);
+
+        if (i >= MMU_NUM_L2) {
+            break;
+        }
+
+        // Break: invalidate the entry and flush its TLB entries on every core
+        mmu_l2_tables[i][j] = 0;
+        asm volatile("dsb ishst\n\ttlbi vaae1is, %0\n\tdsb ish" :: "r"(addr >> PAGE_SHIFT) : "memory");
+
+        // Make: install the new block
+        mmu_l2_tables[i][j] = block_entry(addr, attr);
+    }
+
+    asm volatile("dsb ish\n\tisb" ::: "memory");
+}
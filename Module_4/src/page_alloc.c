@@ -0,0 +1,224 @@
+#include <page_alloc.h>
+#include <spinlock.h>
+#include <string.h>
+#include <mb.h>
+#include <uart.h>
+
+// Free blocks are linked through their own first bytes, the bitmaps are kept apart from the pages
+typedef struct free_block {
+    struct free_block *next;
+    struct free_block *prev;
+} free_block;
+
+extern char _end[];
+
+static free_block free_lists[PAGE_MAX_ORDER];   // Circular lists with sentinel heads
+static uint8_t *free_bitmap[PAGE_MAX_ORDER];    // Bit (pfn >> order) set = block is on free_lists[order]
+static uint64_t end_pfn;
+static page_alloc_stats_t page_stats;
+static spinlock_t page_lock = SPINLOCK_INIT;
+
+// Mailbox Request for the ARM's share of the SDRAM
+static uint32_t get_arm_memory(uint32_t *base, uint32_t *size) {
+    mbox[0] = 8 * 4;
+    mbox[1] = MBOX_REQUEST;
+
+    mbox[2] = MBOX_TAG_GET_ARM_MEM;
+    mbox[3] = 8;
+    mbox[4] = MBOX_REQUEST;
+    mbox[5] = 0;    // Base address
+    mbox[6] = 0;    // Size in bytes
+    mbox[7] = MBOX_TAG_LAST;
+
+    if (mbox_call(MBOX_CH_PROP) && mbox[1] == MBOX_SUCCESS) {
+        *base = mbox[5];
+        *size = mbox[6];
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+static inline uint32_t bit_test(uint32_t order, uint64_t pfn) {
+    uint64_t bit = pfn >> order;
+    return (free_bitmap[order][bit / 8] >> (bit % 8)) & 1;
+}
+
+static inline void bit_flip(uint32_t order, uint64_t pfn) {
+    uint64_t bit = pfn >> order;
+    free_bitmap[order][bit / 8] ^= (1 << (bit % 8));
+}
+
+static void list_push(uint32_t order, uint64_t pfn) {
+    free_block *block = (free_block *)(uintptr_t)(pfn << PAGE_SHIFT);
+    free_block *head = &free_lists[order];
+
+    block->next = head->next;
+    block->prev = head;
+    head->next->prev = block;
+    head->next = block;
+
+    bit_flip(order, pfn);
+    page_stats.free_blocks[order]++;
+}
+
+static void list_remove(uint32_t order, uint64_t pfn) {
+    free_block *block = (free_block *)(uintptr_t)(pfn << PAGE_SHIFT);
+
+    block->prev->next = block->next;
+    block->next->prev = block->prev;
+
+    bit_flip(order, pfn);
+    page_stats.free_blocks[order]--;
+}
+
+/**
+ * Hands RAM from _end up to the top of the ARM memory reported by the mailbox to the allocator.
+ * The per-order bitmaps are carved from the start of that range.
+ */
+void page_alloc_init() {
+    uint32_t base, size;
+
+    if (!get_arm_memory(&base, &size)) {
+        uart_writeText("page_alloc: GET_ARM_MEMORY failed\n");
+        return;
+    }
+
+    end_pfn = ((uint64_t)base + size) >> PAGE_SHIFT;
+    uintptr_t meta = ((uintptr_t)_end + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+
+    // One bit per block of each order, covering pfn 0 to end_pfn
+    for (uint32_t order = 0; order < PAGE_MAX_ORDER; order++) {
+        size_t bytes = (((end_pfn >> order) + 1) + 7) / 8;
+
+        free_bitmap[order] = (uint8_t *)meta;
+        memzero(free_bitmap[order], bytes);
+        meta += bytes;
+
+        free_lists[order].next = &free_lists[order];
+        free_lists[order].prev = &free_lists[order];
+    }
+
+    // Split the remaining range into the largest naturally aligned blocks
+    uint64_t pfn = (meta + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    while (pfn < end_pfn) {
+        uint32_t order = PAGE_MAX_ORDER - 1;
+
+        while ((pfn & ((1UL << order) - 1)) || pfn + (1UL << order) > end_pfn) {
+            order--;
+        }
+
+        list_push(order, pfn);
+        page_stats.total_pages += (1UL << order);
+        pfn += (1UL << order);
+    }
+
+    page_stats.free_pages = page_stats.total_pages;
+}
+
+/**
+ * Allocates 2^order contiguous pages. Returns NULL if no block that large is free.
+ */
+void *page_alloc(uint32_t order) {
+    if (order >= PAGE_MAX_ORDER) {
+        return NULL;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&page_lock);
+
+    // Smallest order with a free block
+    uint32_t found = order;
+    while (found < PAGE_MAX_ORDER && free_lists[found].next == &free_lists[found]) {
+        found++;
+    }
+
+    if (found == PAGE_MAX_ORDER) {
+        page_stats.failed++;
+        spin_unlock_irqrestore(&page_lock, flags);
+        return NULL;
+    }
+
+    uint64_t pfn = (uintptr_t)free_lists[found].next >> PAGE_SHIFT;
+    list_remove(found, pfn);
+
+    // Split, returning the upper halves to the lower free lists
+    while (found > order) {
+        found--;
+        list_push(found, pfn + (1UL << found));
+    }
+
+    page_stats.free_pages -= (1UL << order);
+    page_stats.allocs++;
+    spin_unlock_irqrestore(&page_lock, flags);
+
+    return (void *)(uintptr_t)(pfn << PAGE_SHIFT);
+}
+
+/**
+ * Frees 2^order pages from page_alloc(), merging with free buddies as far up as possible.
+ */
+void page_free(void *addr, uint32_t order) {
+    uint64_t pfn = (uintptr_t)addr >> PAGE_SHIFT;
+
+    if (addr == NULL || order >= PAGE_MAX_ORDER) {
+        return;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&page_lock);
+
+    page_stats.free_pages += (1UL << order);
+    page_stats.frees++;
+
+    while (order < PAGE_MAX_ORDER - 1) {
+        uint64_t buddy = pfn ^ (1UL << order);
+
+        if (buddy >= end_pfn || !bit_test(order, buddy)) {
+            break;
+        }
+
+        list_remove(order, buddy);
+        pfn &= ~(1UL << order);
+        order++;
+    }
+
+    list_push(order, pfn);
+    spin_unlock_irqrestore(&page_lock, flags);
+}
+
+/**
+ * Copies out the allocator counters.
+ */
+void page_alloc_get_stats(page_alloc_stats_t *stats) {
+    uint64_t flags = spin_lock_irqsave(&page_lock);
+    memcpy(stats, &page_stats, sizeof(page_stats));
+    spin_unlock_irqrestore(&page_lock, flags);
+}
+
+/**
+ * Prints the free list length per order and the page totals over UART.
+ */
+void page_alloc_dump() {
+    page_alloc_stats_t stats;
+    page_alloc_get_stats(&stats);
+
+    uart_writeText("---- Page Allocator ----\n");
+    uart_writeText("pages free/total: ");
+    uart_writeUInt(stats.free_pages);
+    uart_writeText("/");
+    uart_writeUInt(stats.total_pages);
+    uart_writeText("\nallocs: ");
+    uart_writeUInt(stats.allocs);
+    uart_writeText(" frees: ");
+    uart_writeUInt(stats.frees);
+    uart_writeText(" failed: ");
+    uart_writeUInt(stats.failed);
+    uart_writeText("\n");
+
+    for (uint32_t order = 0; order < PAGE_MAX_ORDER; order++) {
+        uart_writeText("order ");
+        uart_writeInt(order);
+        uart_writeText(": ");
+        uart_writeInt(stats.free_blocks[order]);
+        uart_writeText("\n");
+    }
+}
@@ -0,0 +1,79 @@
+#include <smp.h>
+#include <mmu.h>
+#include <timer.h>
+
+#define SMP_BOOT_TIMEOUT_US     100000
+
+extern char _start[];
+extern volatile uint64_t spin_table[NUM_CORES];    // Defined in link.ld
+
+percpu_t percpu_data[NUM_CORES];
+static uint8_t __attribute__((aligned(16))) fiq_stacks[NUM_CORES][FIQ_STACK_SIZE];
+
+/**
+ * Points TPIDR_EL1 at this core's per-CPU data and SP_EL0 at its FIQ stack.
+ * Called by every core from boot.S.
+ */
+void smp_percpu_init(uint32_t cpu) {
+    percpu_t *data = &percpu_data[cpu];
+
+    data->cpu_id = cpu;
+    asm volatile("msr TPIDR_EL1, %0" :: "r"(data));
+
+    // The boot core is online from here; secondaries report in from secondary_main()
+    if (cpu == 0) {
+        data->online = 1;
+    }
+
+    // The kernel runs on SP_EL1 (EL1h), so SP_EL0 is free for handle_fiq_el1h to switch to
+    asm volatile("msr SP_EL0, %0" :: "r"(&fiq_stacks[cpu][FIQ_STACK_SIZE]));
+}
+
+/**
+ * Releases cores 1-3 from the firmware spin table into _start and waits for them to come online.
+ * The MMU=0 build leaves them parked: spinlocks need exclusives, which fail on Device memory.
+ */
+void smp_init() {
+#ifndef NO_MMU
+    for (uint32_t cpu = 1; cpu < NUM_CORES; cpu++) {
+        spin_table[cpu] = (uint64_t)(uintptr_t)_start;
+
+        // The parked core polls with its MMU and caches off, so push the write to memory
+        dcache_clean_inval((uintptr_t)&spin_table[cpu], sizeof(spin_table[cpu]));
+    }
+    asm volatile("sev");
+
+    uint32_t start = get_timer32();
+    while (smp_num_online() < NUM_CORES && get_timer32() - start < SMP_BOOT_TIMEOUT_US) {
+        // Wait for the secondaries to finish their boot path
+    }
+#endif
+}
+
+/**
+ * Returns the number of cores that have reached their C entry point.
+ */
+uint32_t smp_num_online() {
+    uint32_t count = 0;
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        count += percpu_data[cpu].online;
+    }
+
+    return count;
+}
+
+/**
+ * Returns a mask of the online cores (bit n = core n).
+ */
+uint32_t smp_online_mask() {
+    uint32_t mask = 0;
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        if (percpu_data[cpu].online) {
+            mask |= 1 << cpu;
+        }
+    }
+
+    return mask;
+}
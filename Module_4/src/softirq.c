@@ -0,0 +1,136 @@
+#include <softirq.h>
+#include <smp.h>
+#include <uart.h>
+
+static softirq_queue_t softirq_queues[NUM_CORES];
+
+/**
+ * Reserves the next slot of a queue. Producers on this core can preempt each other (nested IRQs,
+ * FIQ), so the head moves with ldaxr/stxr; an exception between the two clears the monitor and
+ * the reservation retries. Returns 1 with the reserved index in *slot, or 0 when the queue is full.
+ * Only this result says whether a slot is ours: a consumer can free one right after a full check.
+ */
+static uint32_t softirq_reserve(softirq_queue_t *q, uint32_t *slot) {
+#ifdef NO_MMU
+    // No exclusives with the MMU off (see spinlock.h): mask IRQs and FIQs instead
+    uint64_t flags;
+    asm volatile("mrs %0, DAIF\n\tmsr DAIFSet, #3" : "=r"(flags) :: "memory");
+
+    uint32_t head = q->head;
+    uint32_t reserved = head - q->tail < SOFTIRQ_QUEUE_SIZE;
+    if (reserved) {
+        q->head = head + 1;
+    }
+
+    asm volatile("msr DAIF, %0" :: "r"(flags) : "memory");
+    *slot = head;
+    return reserved;
+#else
+    uint32_t head, used, full;
+
+    asm volatile(
+        "1: ldaxr   %w0, [%3]\n"
+        "   ldr     %w1, [%4]\n"
+        "   sub     %w1, %w0, %w1\n"
+        "   cmp     %w1, %w5\n"
+        "   b.hs    2f\n"
+        "   add     %w1, %w0, #1\n"
+        "   stxr    %w2, %w1, [%3]\n"
+        "   cbnz    %w2, 1b\n"
+        "   b       3f\n"
+        "2: clrex\n"
+        "   mov     %w2, #1\n"
+        "3:\n"
+        : "=&r"(head), "=&r"(used), "=&r"(full)
+        : "r"(&q->head), "r"(&q->tail), "r"(SOFTIRQ_QUEUE_SIZE)
+        : "cc", "memory");
+
+    *slot = head;
+    return !full;
+#endif
+}
+
+/**
+ * Queues fn(arg) to run on this core with IRQs enabled, at the outermost IRQ exit or from the
+ * idle loop. Safe from any context, including FIQ. Returns 1 if queued, 0 if the queue is full.
+ */
+uint32_t softirq_raise(softirq_fn_t fn, void *arg) {
+    softirq_queue_t *q = &softirq_queues[smp_cpu_id()];
+    uint32_t head;
+
+    if (!softirq_reserve(q, &head)) {
+        q->dropped++;
+        return 0;
+    }
+
+    softirq_item_t *item = &q->items[head & (SOFTIRQ_QUEUE_SIZE - 1)];
+    item->fn = fn;
+    item->arg = arg;
+    asm volatile("stlr %w0, [%1]" :: "r"(1), "r"(&item->ready) : "memory");
+
+    q->raised++;
+    return 1;
+}
+
+/**
+ * Returns non-zero if this core has queued work.
+ */
+uint32_t softirq_pending() {
+    softirq_queue_t *q = &softirq_queues[smp_cpu_id()];
+    return q->head != q->tail;
+}
+
+/**
+ * Runs this core's queued work in order. Must be called with IRQs enabled; an IRQ that
+ * arrives meanwhile queues behind the current item instead of running the queue again.
+ */
+void softirq_run() {
+    softirq_queue_t *q = &softirq_queues[smp_cpu_id()];
+
+    if (q->running) {
+        return;
+    }
+    q->running = 1;
+
+    while (q->tail != q->head) {
+        softirq_item_t *item = &q->items[q->tail & (SOFTIRQ_QUEUE_SIZE - 1)];
+        uint32_t ready;
+
+        asm volatile("ldar %w0, [%1]" : "=r"(ready) : "r"(&item->ready) : "memory");
+        if (!ready) {
+            // Its producer was preempted between reserving and publishing; it gets run next time
+            break;
+        }
+
+        softirq_fn_t fn = item->fn;
+        void *arg = item->arg;
+        item->ready = 0;
+        q->tail++;
+
+        fn(arg);
+        q->ran++;
+    }
+
+    q->running = 0;
+}
+
+/**
+ * Prints the per-core queue counters.
+ */
+void softirq_dump() {
+    uart_writeText("---- Softirq ----\n");
+
+    for (uint32_t cpu = 0; cpu < NUM_CORES; cpu++) {
+        softirq_queue_t *q = &softirq_queues[cpu];
+
+        uart_writeText("cpu ");
+        uart_writeInt(cpu);
+        uart_writeText(": raised ");
+        uart_writeUInt(q->raised);
+        uart_writeText(", ran ");
+        uart_writeUInt(q->ran);
+        uart_writeText(", dropped ");
+        uart_writeUInt(q->dropped);
+        uart_writeText("\n");
+    }
+}
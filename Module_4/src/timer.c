@@ -2,47 +2,323 @@
 #include <irq.h>
 #include <gpio.h>
 #include <gic.h>
+#include <spinlock.h>
+#include <idle.h>
+
+#define TIMER1_IRQ_PRIORITY     0x90    // Above the UART, so a long UART drain can't delay a deadline
+#define TIMER_NONE              (~0ULL)
+
+typedef struct sw_timer {
+    struct sw_timer *next;
+    struct sw_timer *prev;
+    uint64_t expires;               // System Timer microseconds
+    timer_callback_t callback;
+    void *ctx;
+    uint16_t gen;                   // Bumped on every release, so stale handles don't match
+    uint8_t level;
+    uint8_t slot;
+    uint8_t active;
+} sw_timer_t;
+
+static sw_timer_t timer_pool[TIMER_POOL_SIZE];
+static sw_timer_t *timer_free;
+
+/**
+ * Level n, slot s holds the timers whose expiry first differs from timer_wheel_time in bit group n
+ * (6 bits per level), and has s in that group. So every timer in a lower level expires before every
+ * timer in a higher one, the lowest occupied slot of a level is its earliest, and nothing pending
+ * expires before timer_wheel_time.
+ */
+static sw_timer_t *timer_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static uint64_t timer_occupied[TIMER_WHEEL_LEVELS];  // Bit s set = slot s non-empty
+static uint64_t timer_wheel_time;
+static uint64_t timer_programmed = TIMER_NONE;       // Deadline compare 1 is set for
+static uint32_t timer_count;
+static uint64_t timer_wakeup_count;
+static spinlock_t timer_lock = SPINLOCK_INIT;
 
 uint32_t get_timer32() {
     return mmio_read(SYS_TIMER_CLO);
 }
 
+/**
+ * Reads the 64-bit System Timer. CLO can wrap between the CHI and CLO reads, so CHI is read again:
+ * if it moved, CLO is re-read to match the new high word.
+ */
 uint64_t get_timer64() {
-    uint64_t timer_hi = mmio_read(SYS_TIMER_CHI);
-    uint64_t res = mmio_read(SYS_TIMER_CLO);
+    uint32_t hi = mmio_read(SYS_TIMER_CHI);
+    uint32_t lo = mmio_read(SYS_TIMER_CLO);
+    uint32_t hi_again = mmio_read(SYS_TIMER_CHI);
+
+    if (hi_again != hi) {
+        lo = mmio_read(SYS_TIMER_CLO);
+    }
 
-    res |= (timer_hi << 32);
-    return res;
+    return ((uint64_t)hi_again << 32) | lo;
 }
 
+/**
+ * Waits `ms` milliseconds, in wfi where it can (see sleep_until()).
+ */
 void timer_wait(int ms) {
-    uint32_t start = get_timer32();
-    uint32_t curr = start;
-    
-    while (curr - start < (ms * 1000)) {
-        curr = get_timer32();
+    sleep_us((uint64_t)ms * 1000);
+}
+
+static void timer_wheel_insert(sw_timer_t *t) {
+    uint64_t diff = t->expires ^ timer_wheel_time;
+    uint32_t level = diff ? (63 - __builtin_clzll(diff)) / TIMER_WHEEL_BITS : 0;
+    uint32_t slot = (t->expires >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+
+    t->level = level;
+    t->slot = slot;
+    t->prev = NULL;
+    t->next = timer_wheel[level][slot];
+    if (t->next) {
+        t->next->prev = t;
+    }
+    timer_wheel[level][slot] = t;
+    timer_occupied[level] |= 1ULL << slot;
+}
+
+static void timer_wheel_remove(sw_timer_t *t) {
+    if (t->prev) {
+        t->prev->next = t->next;
+    } else {
+        timer_wheel[t->level][t->slot] = t->next;
+        if (t->next == NULL) {
+            timer_occupied[t->level] &= ~(1ULL << t->slot);
+        }
+    }
+
+    if (t->next) {
+        t->next->prev = t->prev;
+    }
+}
+
+/**
+ * Earliest pending expiry, or TIMER_NONE. Level 0 slots hold a single deadline each; a higher
+ * level slot is scanned for its earliest timer.
+ */
+static uint64_t timer_wheel_next() {
+    for (uint32_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (timer_occupied[level] == 0) {
+            continue;
+        }
+
+        uint32_t slot = __builtin_ctzll(timer_occupied[level]);
+        if (level == 0) {
+            return (timer_wheel_time & ~(uint64_t)(TIMER_WHEEL_SLOTS - 1)) | slot;
+        }
+
+        uint64_t next = TIMER_NONE;
+        for (sw_timer_t *t = timer_wheel[level][slot]; t; t = t->next) {
+            if (t->expires < next) {
+                next = t->expires;
+            }
+        }
+        return next;
     }
+
+    return TIMER_NONE;
 }
 
 /**
- * Initialization of the System Timer Interrupt via the GIC.
+ * Moves the wheel forward to `time`, which must not be past the earliest expiry. Only the slot
+ * `time` falls into on each level can hold timers that now belong lower; they cascade down,
+ * highest level first. Skipped-over slots are empty, so a long idle jump costs no more than a short one.
+ */
+static void timer_wheel_advance(uint64_t time) {
+    timer_wheel_time = time;
+
+    for (uint32_t level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+        uint32_t slot = (time >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+        sw_timer_t *t = timer_wheel[level][slot];
+
+        timer_wheel[level][slot] = NULL;
+        timer_occupied[level] &= ~(1ULL << slot);
+        while (t) {
+            sw_timer_t *next = t->next;
+            timer_wheel_insert(t);
+            t = next;
+        }
+    }
+}
+
+static void timer_release(sw_timer_t *t) {
+    t->active = 0;
+    t->gen++;
+    t->next = timer_free;
+    timer_free = t;
+    timer_count--;
+}
+
+/**
+ * Points compare 1 at the earliest deadline. One too close to CLO, or already passed, is set a few
+ * microseconds ahead instead; one past the 32-bit compare range gets an intermediate wakeup. Once
+ * the write has landed CLO is checked, since a compare it already passed would not match until the
+ * counter wraps (~71 minutes). With nothing pending compare 1 is left alone: the cleared match can
+ * only come round again after a wrap.
+ */
+static void timer_program() {
+    uint64_t next = timer_wheel_next();
+    uint32_t delta = TIMER_MIN_DELTA_US;
+
+    timer_programmed = next;
+    if (next == TIMER_NONE) {
+        return;
+    }
+
+    while (1) {
+        uint64_t now = get_timer64();
+        uint32_t target;
+
+        if (next <= now + delta) {
+            target = now + delta;
+        } else if (next - now > TIMER_MAX_DELTA_US) {
+            target = now + TIMER_MAX_DELTA_US;
+        } else {
+            target = next;
+        }
+
+        mmio_write(SYS_TIMER_C1, target);
+        if ((int32_t)(target - get_timer32()) > 0) {
+            return;
+        }
+        delta *= 2;
+    }
+}
+
+/**
+ * Sets up the timer pool and installs the compare 1 handler. No interrupt is taken until a timer is added.
  */
 void timer_init() {
-     // set compare value to 1 sec delay
-    uint32_t curr = mmio_read(SYS_TIMER_CLO);
-    mmio_write(SYS_TIMER_C1, curr + CLOCK_HZ);
+    timer_free = NULL;
+    for (int32_t i = TIMER_POOL_SIZE - 1; i >= 0; i--) {
+        timer_pool[i].next = timer_free;
+        timer_free = &timer_pool[i];
+    }
+    timer_wheel_time = get_timer64();
 
-    mmio_write(IRQ0_REGS->IRQ0_ENABLE_0, 0x2);  // enable timer 1 bit
+    irq_register(SYS_TIMER_IRQ_1, handle_timer1, NULL, TIMER1_IRQ_PRIORITY, edge_triggered);
 }
 
 /**
- * Handle Timer 1 interrupt by setting a delay of 1 second.
+ * Calls callback(ctx) from the compare 1 interrupt once the System Timer reaches deadline_us
+ * (absolute, as read by get_timer64()). A deadline already passed fires as soon as possible.
+ * O(1) apart from reprogramming compare 1 when this is the new earliest deadline.
+ * Returns a handle for timer_cancel(), or 0 if the pool is empty or the deadline is out of range.
  */
-void handle_timer1() {
-    // Set Next Compare Value
-    uint32_t curr = mmio_read(SYS_TIMER_CLO);
-    mmio_write(SYS_TIMER_C1, curr + CLOCK_HZ);
+timer_handle_t timer_add(uint64_t deadline_us, timer_callback_t callback, void *ctx) {
+    if (callback == NULL) {
+        return 0;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&timer_lock);
+    sw_timer_t *t = timer_free;
+
+    // Nothing on the wheel expires before timer_wheel_time
+    if (deadline_us < timer_wheel_time) {
+        deadline_us = timer_wheel_time;
+    }
 
-    // Clear the Timer Interrupt to CS Register
-    mmio_write(SYS_TIMER_CS, 0x2);
-}
\ No newline at end of file
+    if (t == NULL || ((deadline_us ^ timer_wheel_time) >> (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS))) {
+        spin_unlock_irqrestore(&timer_lock, flags);
+        return 0;
+    }
+
+    timer_free = t->next;
+    t->expires = deadline_us;
+    t->callback = callback;
+    t->ctx = ctx;
+    t->active = 1;
+    timer_wheel_insert(t);
+    timer_count++;
+
+    if (deadline_us < timer_programmed) {
+        timer_program();
+    }
+
+    timer_handle_t handle = ((uint32_t)t->gen << 16) | (uint32_t)(t - timer_pool + 1);
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return handle;
+}
+
+/**
+ * Removes a pending timer. Returns 1 if it was cancelled, 0 if it already fired or the handle is stale.
+ */
+uint32_t timer_cancel(timer_handle_t handle) {
+    uint32_t index = (handle & 0xFFFF) - 1;
+
+    if (index >= TIMER_POOL_SIZE) {
+        return 0;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&timer_lock);
+    sw_timer_t *t = &timer_pool[index];
+
+    if (!t->active || t->gen != (handle >> 16)) {
+        spin_unlock_irqrestore(&timer_lock, flags);
+        return 0;
+    }
+
+    timer_wheel_remove(t);
+    timer_release(t);
+
+    // Don't leave compare 1 set for a deadline nobody is waiting on
+    if (t->expires == timer_programmed) {
+        timer_program();
+    }
+
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return 1;
+}
+
+/**
+ * Compare 1 handler: runs every timer that is due, then programs the next deadline.
+ * Callbacks run without the timer lock, so they can add and cancel timers.
+ */
+void handle_timer1(void *ctx) {
+    // Clear the match first, so a compare set below that matches right away raises a new interrupt
+    mmio_write(SYS_TIMER_CS, 1 << 1);
+
+    uint64_t flags = spin_lock_irqsave(&timer_lock);
+    timer_wakeup_count++;
+
+    while (1) {
+        uint64_t next = timer_wheel_next();
+        if (next > get_timer64()) {
+            break;
+        }
+
+        timer_wheel_advance(next);
+
+        // A level 0 slot holds only timers expiring at exactly `next`
+        sw_timer_t *t = timer_wheel[0][next & (TIMER_WHEEL_SLOTS - 1)];
+        timer_callback_t callback = t->callback;
+        void *callback_ctx = t->ctx;
+
+        timer_wheel_remove(t);
+        timer_release(t);
+
+        spin_unlock_irqrestore(&timer_lock, flags);
+        callback(callback_ctx);
+        flags = spin_lock_irqsave(&timer_lock);
+    }
+
+    timer_program();
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+/**
+ * Returns how many timers are waiting.
+ */
+uint32_t timer_pending() {
+    return timer_count;
+}
+
+/**
+ * Returns how many compare 1 interrupts have been taken.
+ */
+uint64_t timer_wakeups() {
+    return timer_wakeup_count;
+}
@@ -3,14 +3,40 @@
 #include <mb.h>
 #include <irq.h>
 #include <gic.h>
+#include <softirq.h>
+#include <spinlock.h>
+#include <critical.h>
 
 #define DEFAULT_UART_CLK        7372800
 #define VC_UART_IRQ             0x39
+#define UART_IRQ_PRIORITY       0xA0    // Below the timer tick, so UART work never delays it
 
 // Create UART output buffer
 static volatile unsigned char uart_output_buffer[UART_MAX_QUEUE];
 static volatile uint32_t uart_output_buffer_write;
 static volatile uint32_t uart_output_buffer_read;
+static spinlock_t uart_output_lock = SPINLOCK_INIT;     // The TX interrupt can be routed to any core
+static crit_section_t uart_output_crit = CRIT_SECTION_INIT("uart output", UART_IRQ_PRIORITY);
+
+/**
+ * Masks the UART interrupt level (not the timer) on this core and takes the output buffer lock.
+ */
+static crit_state_t uart_lock() {
+    crit_state_t state = crit_enter(&uart_output_crit);
+    spin_lock(&uart_output_lock);
+    return state;
+}
+
+static void uart_unlock(crit_state_t state) {
+    spin_unlock(&uart_output_lock);
+    crit_exit(&uart_output_crit, state);
+}
+
+// Bytes read by the RX interrupt, echoed later by uart_rx_work()
+static volatile unsigned char uart_rx_buffer[UART_RX_QUEUE];
+static volatile uint32_t uart_rx_write;
+static volatile uint32_t uart_rx_read;
+static volatile uint32_t uart_rx_queued;
 
 // Mailbox Request to get the UART Clock
 static uint32_t __attribute__((unused)) get_uart_clock() {
@@ -87,9 +113,9 @@ void uart_startTX() {
 /**
  * Write a given character to the UART DR or the output buffer to be transmitted.
  * If the FIFO is full, then write to the output buffer until the TX interrupt is asserted
- * Otherwise, we write directly to the UART Data Register
+ * Otherwise, we write directly to the UART Data Register. Called with the output lock held.
  */
-void uart_writeByte(unsigned char ch) {
+static void uart_queueByte(unsigned char ch) {
     // Directly write to FIFO
     if (!UART0_TXFF && uart_bufferEmpty()) {
         mmio_write(UART0_DR, ch);
@@ -110,6 +136,35 @@ void uart_writeByte(unsigned char ch) {
     }
 }
 
+/**
+ * Writes a character to the UART. If the output buffer is full its queued bytes are lost.
+ */
+void uart_writeByte(unsigned char ch) {
+    // The TX interrupt and deferred work also move the buffer indices
+    crit_state_t state = uart_lock();
+    uart_queueByte(ch);
+    uart_unlock(state);
+}
+
+/**
+ * Like uart_writeByte(), but never drops queued output: while the output buffer is full it moves
+ * bytes into the FIFO itself as room appears, since the TX interrupt may be masked on this core.
+ * For binary streams, where one lost byte breaks the framing.
+ */
+void uart_writeByteWait(unsigned char ch) {
+    crit_state_t state = uart_lock();
+
+    while ((uart_output_buffer_write + 1) % UART_MAX_QUEUE == uart_output_buffer_read) {
+        if (!UART0_TXFF) {
+            mmio_write(UART0_DR, uart_output_buffer[uart_output_buffer_read]);
+            uart_output_buffer_read = (uart_output_buffer_read + 1) % UART_MAX_QUEUE;
+        }
+    }
+    uart_queueByte(ch);
+
+    uart_unlock(state);
+}
+
 /**
  * Prints out the integer to UART in base 10 digits.
  */
@@ -144,6 +199,24 @@ void uart_writeInt(int num) {
     }
 }
 
+/**
+ * Prints out the unsigned 64-bit integer to UART in base 10 digits.
+ */
+void uart_writeUInt(uint64_t num) {
+    char buf[UINT_BUF_SIZE];
+    int i = 0;
+
+    do {
+        buf[i++] = (num % 10) + '0';
+        num /= 10;
+    } while (num > 0);
+
+    // Prints characters in order
+    while(i > 0) {
+        uart_writeByte(buf[--i]);
+    }
+}
+
 /**
  * Prints out the integer to UART in hexadecimal format.
  */
@@ -209,9 +282,11 @@ void set_fifo_level(fifo_level_t rx_sel, fifo_level_t tx_sel) {
  *  - Enable TX, RX and UART
  */
 void uart_init() {
-    // Disable UART first
+    // Disable UART first and let any character in flight finish
     mmio_write(UART0_CR, 0);
-    delay(1000);
+    while (UART0_BUSY) {
+        // Wait for the end of transmission
+    }
     
     // Flush FIFO by setting FEN to 0
     mmio_write(UART0_LCRH, (3 << 5));
@@ -221,6 +296,8 @@ void uart_init() {
     
     uart_output_buffer_write = 0;
     uart_output_buffer_read = 0;
+    uart_rx_write = 0;
+    uart_rx_read = 0;
 
     // Setting UART CLK Rate
     set_uart_clk(DEFAULT_UART_CLK);
@@ -244,12 +321,14 @@ void uart_init() {
     // Enable TX and RX and UART again
     uint32_t cr_val = (1 << 9) | (1 << 8) | 1;
     mmio_write(UART0_CR, cr_val);
+
+    irq_register(PL011_UART_IRQ, uart_handler, NULL, UART_IRQ_PRIORITY, level_sensitive);
 }
 
 /**
  * When the IRQ line is asserted for the UART this handles it for all UART.
  */
-void uart_handler() {
+void uart_handler(void *ctx) {
     // Check which IRQ was set (reading bits 16 - 20)
     uint32_t uart_id = (mmio_read(PACTL_CS) >> 16) & 0x1F;
 
@@ -278,31 +357,36 @@ void uart_handler() {
  *  - Refills Transmit FIFO
  */ 
 void uart_tx_handler() {
-    // Check if the buffer is not empty and TX FIFO is not full
-    do {
-        // write the next char in the buffer
-        if (!UART0_TXFF) {
-            mmio_write(UART0_DR, uart_output_buffer[uart_output_buffer_read]);
-            uart_output_buffer_read = (uart_output_buffer_read + 1) % UART_MAX_QUEUE;
-        }
-    } while (!uart_bufferEmpty());
+    crit_state_t state = uart_lock();
+
+    // Refill the TX FIFO with what fits; the next TX interrupt continues from there
+    while (!uart_bufferEmpty() && !UART0_TXFF) {
+        mmio_write(UART0_DR, uart_output_buffer[uart_output_buffer_read]);
+        uart_output_buffer_read = (uart_output_buffer_read + 1) % UART_MAX_QUEUE;
+    }
 
     // Clear the Transmit Interrupt
     mmio_write(UART0_ICR, UART_TX_BIT);
 
-    // Suspend the Transmit Interrupt
-    uint32_t mask_val = mmio_read(UART0_IMSC) & ~UART_TX_BIT;
-    mmio_write(UART0_IMSC, mask_val);
+    // Suspend the Transmit Interrupt once the buffer is drained
+    if (uart_bufferEmpty()) {
+        uint32_t mask_val = mmio_read(UART0_IMSC) & ~UART_TX_BIT;
+        mmio_write(UART0_IMSC, mask_val);
+    }
+
+    uart_unlock(state);
 }
 
 /**
- * Helper function to read and write the characters from the Receive FIFO.
+ * Deferred half of the receive path: echoes the buffered characters with IRQs enabled.
  */
-static void get_chars() {
-    // Check if the Receive FIFO is not empty and UART is not busy transmitting
-    while(!UART0_RXFE) {
-        char c = (char) (mmio_read(UART0_DR) & 0xFF); // reads the first 8 bits of the Data Reg
-        
+static void uart_rx_work(void *arg) {
+    uart_rx_queued = 0;
+
+    while (uart_rx_read != uart_rx_write) {
+        char c = uart_rx_buffer[uart_rx_read];
+        uart_rx_read = (uart_rx_read + 1) & (UART_RX_QUEUE - 1);
+
         if (c == '\r') {
             // Add newline with return key
             uart_writeByte('\r');
@@ -313,11 +397,34 @@ static void get_chars() {
     }
 }
 
+/**
+ * Helper function to move the characters from the Receive FIFO into the RX buffer
+ * and queue the echo as deferred work.
+ */
+static void get_chars() {
+    while(!UART0_RXFE) {
+        char c = (char) (mmio_read(UART0_DR) & 0xFF); // reads the first 8 bits of the Data Reg
+        uint32_t next = (uart_rx_write + 1) & (UART_RX_QUEUE - 1);
+
+        if (next != uart_rx_read) {
+            uart_rx_buffer[uart_rx_write] = c;
+            uart_rx_write = next;
+        }
+    }
+
+    if (!uart_rx_queued) {
+        uart_rx_queued = 1;
+        if (!softirq_raise(uart_rx_work, NULL)) {
+            uart_rx_queued = 0;
+        }
+    }
+}
+
 /**
  * Handles the UART 0 Receiver Interrupt.
  */
 void uart_rx_handler() {
-    // Push characters into Transmit FIFO
+    // Empty the Receive FIFO and defer the echo
     get_chars();
 
     // clear the interrupt
@@ -334,3 +441,10 @@ void uart_rt_handler() {
     // clear the interrupt
     mmio_write(UART0_ICR, UART_RT_BIT);
 }
+
+/**
+ * Prints the hold times of the UART output critical section.
+ */
+void uart_crit_dump() {
+    crit_dump(&uart_output_crit);
+}
@@ -0,0 +1,187 @@
+#include <wave.h>
+#include <gpio.h>
+#include <irq.h>
+#include <timer.h>
+
+static wave_step_t wave_steps[WAVE_MAX_STEPS];
+static uint32_t wave_count;
+static uint32_t wave_next;
+static uint32_t wave_base;              // CLO value of time 0 for the current pass
+static uint32_t wave_period;            // 0 = play once
+static volatile uint32_t wave_running;
+static wave_stats_t wave_stats;
+
+/**
+ * Drives every pin of one step: at most one write per register, and none for an empty bank.
+ */
+static void wave_emit(wave_step_t *step) {
+    if (step->set[0]) {
+        mmio_write(GPSET0, step->set[0]);
+    }
+    if (step->set[1]) {
+        mmio_write(GPSET1, step->set[1]);
+    }
+    if (step->clr[0]) {
+        mmio_write(GPCLR0, step->clr[0]);
+    }
+    if (step->clr[1]) {
+        mmio_write(GPCLR1, step->clr[1]);
+    }
+}
+
+static void wave_finish() {
+    wave_running = 0;
+    irq_unregister(SYS_TIMER_IRQ_3);
+}
+
+/**
+ * Compare 3 handler. C3 is set WAVE_LEAD_US before a step, so the variable IRQ entry time is
+ * absorbed by spinning on CLO to the exact microsecond. Steps within WAVE_SPIN_US of each other
+ * are emitted from the same interrupt, so C3 is never set for a time that has already gone by.
+ */
+static void wave_irq(void *ctx) {
+    mmio_write(SYS_TIMER_CS, 1 << 3);
+    if (!wave_running) {
+        // A stale match taken between irq_register() and the start of the waveform
+        return;
+    }
+    wave_stats.interrupts++;
+
+    while (wave_running) {
+        wave_step_t *step = &wave_steps[wave_next];
+        uint32_t target = wave_base + step->time_us;
+
+        if ((int32_t)(target - get_timer32()) > WAVE_SPIN_US) {
+            uint32_t fire = target - WAVE_LEAD_US;
+
+            mmio_write(SYS_TIMER_C3, fire);
+            if ((int32_t)(fire - get_timer32()) > 0) {
+                return;
+            }
+            continue;       // CLO got there first: spin instead
+        }
+
+        uint32_t now;
+        while ((int32_t)(target - (now = get_timer32())) > 0) {
+            // Spin to the edge
+        }
+        wave_emit(step);
+
+        uint32_t late = now - target;
+        wave_stats.steps++;
+        wave_stats.late_total += late;
+        if (late > wave_stats.late_max) {
+            wave_stats.late_max = late;
+        }
+
+        if (++wave_next == wave_count) {
+            if (wave_period == 0) {
+                wave_finish();
+                return;
+            }
+            wave_next = 0;
+            wave_base += wave_period;
+        }
+    }
+}
+
+/**
+ * Plays a list of edges sorted by time: edges on the same microsecond are merged into one step.
+ * The pins are made outputs. With period_us set the waveform repeats every period_us until
+ * wave_stop(). The gap from the last edge to the next pass's first must be over WAVE_SPIN_US, so
+ * the interrupt returns at least once a period instead of spinning through every pass. Returns 1
+ * on success, 0 if a waveform is already playing, compare 3 is taken, the period is too short, or
+ * the list is empty, unsorted, too long, or names a bad pin or level.
+ */
+uint32_t wave_start(wave_edge_t *edges, uint32_t count, uint32_t period_us) {
+    uint32_t n = 0;
+
+    if (wave_running || count == 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        wave_edge_t *edge = &edges[i];
+
+        if (edge->pin > GPIO_MAX_PIN || edge->level > 1 || (i > 0 && edge->time_us < edges[i - 1].time_us)) {
+            return 0;
+        }
+
+        if (n == 0 || wave_steps[n - 1].time_us != edge->time_us) {
+            if (n == WAVE_MAX_STEPS) {
+                return 0;
+            }
+            wave_steps[n].time_us = edge->time_us;
+            wave_steps[n].set[0] = wave_steps[n].set[1] = 0;
+            wave_steps[n].clr[0] = wave_steps[n].clr[1] = 0;
+            n++;
+        }
+
+        // A later edge for the same pin on the same microsecond wins
+        wave_step_t *step = &wave_steps[n - 1];
+        uint32_t bank = edge->pin / 32;
+        uint32_t bit = 1 << (edge->pin % 32);
+        if (edge->level) {
+            step->set[bank] |= bit;
+            step->clr[bank] &= ~bit;
+        } else {
+            step->clr[bank] |= bit;
+            step->set[bank] &= ~bit;
+        }
+    }
+
+    if (period_us && period_us <= wave_steps[n - 1].time_us + WAVE_SPIN_US - wave_steps[0].time_us) {
+        return 0;
+    }
+
+    // Claim compare 3 before touching it, so a failed start leaves its current owner alone
+    if (!irq_register(SYS_TIMER_IRQ_3, wave_irq, NULL, WAVE_IRQ_PRIORITY, edge_triggered)) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        gpio_function(edges[i].pin, GPIO_FUNCTION_OUT);
+    }
+
+    wave_count = n;
+    wave_next = 0;
+    wave_period = period_us;
+    wave_base = get_timer32() + WAVE_START_DELAY_US;
+
+    // Drop a stale match, then let the handler see the waveform
+    mmio_write(SYS_TIMER_C3, wave_base + wave_steps[0].time_us - WAVE_LEAD_US);
+    mmio_write(SYS_TIMER_CS, 1 << 3);
+    asm volatile("dsb sy" ::: "memory");
+    wave_running = 1;
+    return 1;
+}
+
+/**
+ * Stops a playing waveform. Pins keep their current level.
+ */
+void wave_stop() {
+    uint64_t flags = irq_save();
+
+    if (wave_running) {
+        wave_finish();
+    }
+    irq_restore(flags);
+}
+
+/**
+ * Returns non-zero while a waveform is playing.
+ */
+uint32_t wave_busy() {
+    return wave_running;
+}
+
+void wave_get_stats(wave_stats_t *stats) {
+    *stats = wave_stats;
+}
+
+void wave_reset_stats() {
+    wave_stats.steps = 0;
+    wave_stats.interrupts = 0;
+    wave_stats.late_total = 0;
+    wave_stats.late_max = 0;
+}